@@ -0,0 +1,247 @@
+/*************************************************************************/
+/*  lottie_batch_converter.cpp                                           */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "lottie_batch_converter.h"
+
+#include "core/os/dir_access.h"
+#include "core/os/os.h"
+#include "resource_importer_lottie.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct BatchFile {
+	String source;
+	String scene;
+	ResourceImporterLottie::RenderedFrames frames;
+	Error error = OK;
+	double msec = 0;
+};
+
+struct BatchFrame {
+	ResourceImporterLottie::StreamedFrame *frame = nullptr;
+	bool saved = false;
+};
+
+// Workers only render, textures and the resource saver are not thread safe.
+// Rendered files and streamed frames are queued for the calling thread, which
+// builds and saves them.
+struct BatchJob {
+	Map<StringName, Variant> options;
+	BatchFile *files = nullptr;
+	int32_t file_count = 0;
+	std::atomic<int32_t> next_file;
+
+	std::mutex mutex;
+	std::condition_variable queued;
+	std::condition_variable saved;
+	List<int32_t> rendered_files;
+	List<BatchFrame *> streamed_frames;
+	int32_t running_workers = 0;
+	// Rendered files waiting to be saved, workers stop rendering more once
+	// this many are queued.
+	int32_t max_rendered_files = 1;
+};
+
+static void _find_json_files(const String &p_dir, const String &p_relative_dir, Vector<String> &r_files) {
+	DirAccess *dir = DirAccess::open(p_dir);
+	ERR_FAIL_COND(!dir);
+	dir->list_dir_begin();
+	String file = dir->get_next();
+	while (!file.empty()) {
+		if (file != "." && file != "..") {
+			if (dir->current_is_dir()) {
+				_find_json_files(p_dir.plus_file(file), p_relative_dir.plus_file(file), r_files);
+			} else if (file.get_extension().to_lower() == "json") {
+				r_files.push_back(p_relative_dir.plus_file(file));
+			}
+		}
+		file = dir->get_next();
+	}
+	dir->list_dir_end();
+	memdelete(dir);
+}
+
+// Hands a streamed frame to the calling thread and waits until it is saved.
+static void _queue_streamed_frame(void *p_userdata, ResourceImporterLottie::StreamedFrame &r_frame) {
+	BatchJob *job = (BatchJob *)p_userdata;
+	BatchFrame batch_frame;
+	batch_frame.frame = &r_frame;
+	std::unique_lock<std::mutex> lock(job->mutex);
+	job->streamed_frames.push_back(&batch_frame);
+	job->queued.notify_one();
+	job->saved.wait(lock, [&] { return batch_frame.saved; });
+}
+
+static void _render_files(BatchJob *p_job) {
+	for (int32_t file_i = p_job->next_file++; file_i < p_job->file_count; file_i = p_job->next_file++) {
+		BatchFile &file = p_job->files[file_i];
+		uint64_t begin = OS::get_singleton()->get_ticks_usec();
+		file.error = ResourceImporterLottie::render_frames(file.source, file.scene.get_basename(), p_job->options, file.frames, _queue_streamed_frame, p_job);
+		file.msec = (OS::get_singleton()->get_ticks_usec() - begin) / 1000.0;
+		std::unique_lock<std::mutex> lock(p_job->mutex);
+		p_job->rendered_files.push_back(file_i);
+		p_job->queued.notify_one();
+		p_job->saved.wait(lock, [&] { return p_job->rendered_files.size() < p_job->max_rendered_files; });
+	}
+	std::lock_guard<std::mutex> lock(p_job->mutex);
+	p_job->running_workers--;
+	p_job->queued.notify_one();
+}
+
+static void _save_file(BatchJob *p_job, BatchFile &r_file) {
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	if (r_file.error == OK) {
+		List<String> gen_files;
+		r_file.error = ResourceImporterLottie::save_scene(r_file.source, r_file.scene.get_basename(), p_job->options, r_file.frames, &gen_files);
+	}
+	r_file.frames = ResourceImporterLottie::RenderedFrames();
+	r_file.msec += (OS::get_singleton()->get_ticks_usec() - begin) / 1000.0;
+	if (r_file.error == OK) {
+		print_line(vformat("%s: %.1f ms", r_file.source, r_file.msec));
+	} else {
+		print_line(vformat("%s: failed with error %d after %.1f ms", r_file.source, r_file.error, r_file.msec));
+	}
+}
+
+// Saves what the workers queue until every worker is done. Streamed frames
+// go first, their worker waits on them.
+static void _save_files(BatchJob *p_job) {
+	std::unique_lock<std::mutex> lock(p_job->mutex);
+	while (true) {
+		p_job->queued.wait(lock, [&] { return !p_job->streamed_frames.empty() || !p_job->rendered_files.empty() || !p_job->running_workers; });
+		if (!p_job->streamed_frames.empty()) {
+			BatchFrame *batch_frame = p_job->streamed_frames.front()->get();
+			p_job->streamed_frames.pop_front();
+			lock.unlock();
+			ResourceImporterLottie::save_streamed_frame(*batch_frame->frame);
+			lock.lock();
+			batch_frame->saved = true;
+			p_job->saved.notify_all();
+		} else if (!p_job->rendered_files.empty()) {
+			int32_t file_i = p_job->rendered_files.front()->get();
+			p_job->rendered_files.pop_front();
+			p_job->saved.notify_all();
+			lock.unlock();
+			_save_file(p_job, p_job->files[file_i]);
+			lock.lock();
+		} else {
+			break;
+		}
+	}
+}
+
+Dictionary LottieBatchConverter::convert_directory(const String &p_source_dir, const String &p_target_dir, const Dictionary &p_options, int p_threads) {
+	Dictionary result;
+	result["converted"] = 0;
+	result["failed"] = 0;
+	result["files"] = Array();
+
+	BatchJob job;
+	Ref<ResourceImporterLottie> importer;
+	importer.instance();
+	List<ResourceImporter::ImportOption> import_options;
+	importer->get_import_options(&import_options);
+	for (List<ResourceImporter::ImportOption>::Element *E = import_options.front(); E; E = E->next()) {
+		job.options[E->get().option.name] = E->get().default_value;
+	}
+	Array option_names = p_options.keys();
+	for (int32_t option_i = 0; option_i < option_names.size(); option_i++) {
+		String option_name = option_names[option_i];
+		if (!job.options.has(option_name)) {
+			WARN_PRINT(("Unknown Lottie import option: " + option_name + ".").utf8().get_data());
+			continue;
+		}
+		job.options[option_name] = p_options[option_names[option_i]];
+	}
+
+	Vector<String> relative_paths;
+	_find_json_files(p_source_dir, "", relative_paths);
+	int32_t thread_count = p_threads > 0 ? p_threads : OS::get_singleton()->get_processor_count();
+	thread_count = CLAMP(thread_count, 1, MAX(relative_paths.size(), 1));
+	// Every file already renders its frames on all cores, with several files
+	// at once each renders on its own thread unless the options say otherwise.
+	if (thread_count > 1 && !p_options.has("render/threads")) {
+		job.options["render/threads"] = 1;
+	}
+	DirAccess *target_dir = DirAccess::create_for_path(p_target_dir);
+	ERR_FAIL_COND_V(!target_dir, result);
+	Vector<BatchFile> files;
+	for (int32_t file_i = 0; file_i < relative_paths.size(); file_i++) {
+		BatchFile file;
+		file.source = p_source_dir.plus_file(relative_paths[file_i]);
+		file.scene = p_target_dir.plus_file(relative_paths[file_i].get_basename() + ".scn");
+		target_dir->make_dir_recursive(file.scene.get_base_dir());
+		files.push_back(file);
+	}
+	memdelete(target_dir);
+
+	// Workers claim files by index and only write their own entries until
+	// they queue them.
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	job.files = files.ptrw();
+	job.file_count = files.size();
+	job.next_file = 0;
+	job.running_workers = thread_count;
+	job.max_rendered_files = thread_count;
+	std::vector<std::thread> threads;
+	for (int32_t thread_i = 0; thread_i < thread_count; thread_i++) {
+		threads.emplace_back(_render_files, &job);
+	}
+	_save_files(&job);
+	for (size_t thread_i = 0; thread_i < threads.size(); thread_i++) {
+		threads[thread_i].join();
+	}
+
+	int32_t converted = 0;
+	Array file_results;
+	for (int32_t file_i = 0; file_i < files.size(); file_i++) {
+		const BatchFile &file = files[file_i];
+		Dictionary file_result;
+		file_result["source"] = file.source;
+		file_result["scene"] = file.scene;
+		file_result["error"] = file.error;
+		file_result["msec"] = file.msec;
+		file_results.push_back(file_result);
+		converted += file.error == OK;
+	}
+	result["converted"] = converted;
+	result["failed"] = files.size() - converted;
+	result["files"] = file_results;
+	print_line(vformat("Converted %d of %d Lottie files in %.1f ms on %d threads.", converted, files.size(), (OS::get_singleton()->get_ticks_usec() - begin) / 1000.0, thread_count));
+	return result;
+}
+
+void LottieBatchConverter::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("convert_directory", "source_dir", "target_dir", "options", "threads"), &LottieBatchConverter::convert_directory, DEFVAL(Dictionary()), DEFVAL(0));
+}
@@ -0,0 +1,53 @@
+/*************************************************************************/
+/*  lottie_batch_converter.h                                             */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef LOTTIE_BATCH_CONVERTER_H
+#define LOTTIE_BATCH_CONVERTER_H
+
+#include "core/reference.h"
+
+// Converts every Lottie JSON below a directory into scenes with the importer,
+// without the editor. Files render on a pool of worker threads, textures and
+// scenes are saved on the calling thread. The options are the importer
+// options, missing ones take their defaults.
+class LottieBatchConverter : public Reference {
+	GDCLASS(LottieBatchConverter, Reference);
+
+protected:
+	static void _bind_methods();
+
+public:
+	// Returns a Dictionary with the "converted" and "failed" counts and a
+	// "files" Array with the source, scene, error and msec of every file.
+	Dictionary convert_directory(const String &p_source_dir, const String &p_target_dir, const Dictionary &p_options, int p_threads = 0);
+
+	LottieBatchConverter() {}
+};
+
+#endif // LOTTIE_BATCH_CONVERTER_H
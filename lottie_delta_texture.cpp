@@ -0,0 +1,251 @@
+/*************************************************************************/
+/*  lottie_delta_texture.cpp                                             */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "lottie_delta_texture.h"
+
+#include "core/os/os.h"
+#include "servers/visual_server.h"
+
+void LottieDeltaTexture::create(int p_width, int p_height) {
+	ERR_FAIL_COND(p_width <= 0 || p_height <= 0);
+	width = p_width;
+	height = p_height;
+	VS::get_singleton()->texture_allocate(texture, width, height, 0, Image::FORMAT_RGBA8, VS::TEXTURE_TYPE_2D, flags);
+	frame_rects.clear();
+	frame_data.clear();
+	keyframes.resize(0);
+	shown_frame = -1;
+	emit_changed();
+}
+
+void LottieDeltaTexture::add_frame(const Rect2 &p_rect, const PoolVector<uint8_t> &p_data, bool p_keyframe) {
+	if (p_keyframe) {
+		keyframes.push_back(frame_rects.size());
+	}
+	frame_rects.push_back(p_rect);
+	frame_data.push_back(p_data);
+}
+
+int LottieDeltaTexture::get_frame_count() const {
+	return frame_rects.size();
+}
+
+int LottieDeltaTexture::_get_keyframe(int p_frame) const {
+	int keyframe = -1;
+	PoolIntArray::Read read = keyframes.read();
+	for (int keyframe_i = 0; keyframe_i < keyframes.size() && read[keyframe_i] <= p_frame; keyframe_i++) {
+		keyframe = read[keyframe_i];
+	}
+	return keyframe;
+}
+
+void LottieDeltaTexture::_apply_frame(int p_frame) {
+	ERR_FAIL_INDEX(p_frame, frame_data.size());
+	ERR_FAIL_INDEX(p_frame, frame_rects.size());
+	PoolVector<uint8_t> data = frame_data[p_frame];
+	if (!data.size()) {
+		return;
+	}
+	ERR_FAIL_COND(!Image::lossless_unpacker);
+	Ref<Image> patch = Image::lossless_unpacker(data);
+	ERR_FAIL_COND(patch.is_null());
+	Rect2 rect = frame_rects[p_frame];
+	VS::get_singleton()->texture_set_data_partial(texture, patch, 0, 0, rect.size.width, rect.size.height, rect.position.x, rect.position.y, 0);
+}
+
+void LottieDeltaTexture::_update_frame() {
+	uint64_t ticks = OS::get_singleton()->get_ticks_usec();
+	float delta = prev_ticks ? (ticks - prev_ticks) / 1000000.0 : 0;
+	prev_ticks = ticks;
+	int frame_count = get_frame_count();
+	if (!frame_count || !width) {
+		return;
+	}
+	if (playing && frame_rate > 0) {
+		time += delta;
+		float length = frame_count / frame_rate;
+		if (time >= length) {
+			if (loop) {
+				time = Math::fmod(time, length);
+			} else {
+				time = length;
+				playing = false;
+			}
+		}
+		current_frame = MIN(int(time * frame_rate), frame_count - 1);
+	}
+	current_frame = MIN(current_frame, frame_count - 1);
+	if (current_frame == shown_frame) {
+		return;
+	}
+	// Replay from the closest keyframe unless the shown frame lies between it
+	// and the wanted one.
+	int first_frame = _get_keyframe(current_frame);
+	ERR_FAIL_COND(first_frame == -1);
+	if (shown_frame >= first_frame && shown_frame < current_frame) {
+		first_frame = shown_frame + 1;
+	}
+	for (int frame = first_frame; frame <= current_frame; frame++) {
+		_apply_frame(frame);
+	}
+	shown_frame = current_frame;
+}
+
+void LottieDeltaTexture::set_frame_rate(float p_frame_rate) {
+	frame_rate = MAX(p_frame_rate, 0);
+}
+
+float LottieDeltaTexture::get_frame_rate() const {
+	return frame_rate;
+}
+
+void LottieDeltaTexture::set_playing(bool p_playing) {
+	playing = p_playing;
+}
+
+bool LottieDeltaTexture::is_playing() const {
+	return playing;
+}
+
+void LottieDeltaTexture::set_loop(bool p_loop) {
+	loop = p_loop;
+}
+
+bool LottieDeltaTexture::has_loop() const {
+	return loop;
+}
+
+void LottieDeltaTexture::set_current_frame(int p_frame) {
+	// Frames are loaded before the current frame, an empty texture keeps the
+	// value until they are.
+	current_frame = frame_data.size() ? CLAMP(p_frame, 0, frame_data.size() - 1) : MAX(p_frame, 0);
+	if (frame_rate > 0) {
+		time = current_frame / frame_rate;
+	}
+}
+
+int LottieDeltaTexture::get_current_frame() const {
+	return current_frame;
+}
+
+void LottieDeltaTexture::_set_size(const Vector2 &p_size) {
+	if (p_size.x > 0 && p_size.y > 0) {
+		create(p_size.x, p_size.y);
+	}
+}
+
+Vector2 LottieDeltaTexture::_get_size() const {
+	return Vector2(width, height);
+}
+
+void LottieDeltaTexture::_set_frame_rects(const Array &p_rects) {
+	frame_rects = p_rects;
+	shown_frame = -1;
+}
+
+void LottieDeltaTexture::_set_frame_data(const Array &p_data) {
+	frame_data = p_data;
+	shown_frame = -1;
+}
+
+void LottieDeltaTexture::_set_keyframes(const PoolIntArray &p_keyframes) {
+	keyframes = p_keyframes;
+	shown_frame = -1;
+}
+
+int LottieDeltaTexture::get_width() const {
+	return width;
+}
+
+int LottieDeltaTexture::get_height() const {
+	return height;
+}
+
+RID LottieDeltaTexture::get_rid() const {
+	return texture;
+}
+
+bool LottieDeltaTexture::has_alpha() const {
+	return true;
+}
+
+void LottieDeltaTexture::set_flags(uint32_t p_flags) {
+	flags = p_flags;
+	if (width) {
+		VS::get_singleton()->texture_set_flags(texture, flags);
+	}
+}
+
+uint32_t LottieDeltaTexture::get_flags() const {
+	return flags;
+}
+
+void LottieDeltaTexture::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("create", "width", "height"), &LottieDeltaTexture::create);
+	ClassDB::bind_method(D_METHOD("add_frame", "rect", "data", "keyframe"), &LottieDeltaTexture::add_frame);
+	ClassDB::bind_method(D_METHOD("get_frame_count"), &LottieDeltaTexture::get_frame_count);
+	ClassDB::bind_method(D_METHOD("set_frame_rate", "frame_rate"), &LottieDeltaTexture::set_frame_rate);
+	ClassDB::bind_method(D_METHOD("get_frame_rate"), &LottieDeltaTexture::get_frame_rate);
+	ClassDB::bind_method(D_METHOD("set_playing", "playing"), &LottieDeltaTexture::set_playing);
+	ClassDB::bind_method(D_METHOD("is_playing"), &LottieDeltaTexture::is_playing);
+	ClassDB::bind_method(D_METHOD("set_loop", "loop"), &LottieDeltaTexture::set_loop);
+	ClassDB::bind_method(D_METHOD("has_loop"), &LottieDeltaTexture::has_loop);
+	ClassDB::bind_method(D_METHOD("set_current_frame", "frame"), &LottieDeltaTexture::set_current_frame);
+	ClassDB::bind_method(D_METHOD("get_current_frame"), &LottieDeltaTexture::get_current_frame);
+	ClassDB::bind_method(D_METHOD("_update_frame"), &LottieDeltaTexture::_update_frame);
+	ClassDB::bind_method(D_METHOD("_set_size", "size"), &LottieDeltaTexture::_set_size);
+	ClassDB::bind_method(D_METHOD("_get_size"), &LottieDeltaTexture::_get_size);
+	ClassDB::bind_method(D_METHOD("_set_frame_rects", "rects"), &LottieDeltaTexture::_set_frame_rects);
+	ClassDB::bind_method(D_METHOD("_get_frame_rects"), &LottieDeltaTexture::_get_frame_rects);
+	ClassDB::bind_method(D_METHOD("_set_frame_data", "data"), &LottieDeltaTexture::_set_frame_data);
+	ClassDB::bind_method(D_METHOD("_get_frame_data"), &LottieDeltaTexture::_get_frame_data);
+	ClassDB::bind_method(D_METHOD("_set_keyframes", "keyframes"), &LottieDeltaTexture::_set_keyframes);
+	ClassDB::bind_method(D_METHOD("_get_keyframes"), &LottieDeltaTexture::_get_keyframes);
+
+	ADD_PROPERTY(PropertyInfo(Variant::VECTOR2, "_size", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NOEDITOR | PROPERTY_USAGE_INTERNAL), "_set_size", "_get_size");
+	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "_frame_rects", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NOEDITOR | PROPERTY_USAGE_INTERNAL), "_set_frame_rects", "_get_frame_rects");
+	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "_frame_data", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NOEDITOR | PROPERTY_USAGE_INTERNAL), "_set_frame_data", "_get_frame_data");
+	ADD_PROPERTY(PropertyInfo(Variant::POOL_INT_ARRAY, "_keyframes", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NOEDITOR | PROPERTY_USAGE_INTERNAL), "_set_keyframes", "_get_keyframes");
+	ADD_PROPERTY(PropertyInfo(Variant::REAL, "frame_rate", PROPERTY_HINT_RANGE, "0,120,0.01,or_greater"), "set_frame_rate", "get_frame_rate");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "playing"), "set_playing", "is_playing");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "loop"), "set_loop", "has_loop");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "current_frame"), "set_current_frame", "get_current_frame");
+}
+
+LottieDeltaTexture::LottieDeltaTexture() {
+	texture = VS::get_singleton()->texture_create();
+	// Same hook AnimatedTexture uses to advance before every frame is drawn.
+	VS::get_singleton()->connect("frame_pre_draw", this, "_update_frame");
+}
+
+LottieDeltaTexture::~LottieDeltaTexture() {
+	VS::get_singleton()->disconnect("frame_pre_draw", this, "_update_frame");
+	VS::get_singleton()->free(texture);
+}
@@ -0,0 +1,101 @@
+/*************************************************************************/
+/*  lottie_delta_texture.h                                               */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef LOTTIE_DELTA_TEXTURE_H
+#define LOTTIE_DELTA_TEXTURE_H
+
+#include "scene/resources/texture.h"
+
+// Plays back frames stored as changes from the frame before them. Every frame
+// keeps only the rect that changed, PNG compressed, and full keyframes are
+// stored at intervals so seeking does not replay from the first frame. The
+// texture animates itself and only uploads the changed rect of each frame.
+class LottieDeltaTexture : public Texture {
+	GDCLASS(LottieDeltaTexture, Texture);
+
+	RID texture;
+	int width = 0;
+	int height = 0;
+	uint32_t flags = FLAG_FILTER;
+
+	Array frame_rects;
+	Array frame_data;
+	PoolIntArray keyframes;
+
+	float frame_rate = 30;
+	bool playing = true;
+	bool loop = true;
+	int current_frame = 0;
+	int shown_frame = -1;
+	float time = 0;
+	uint64_t prev_ticks = 0;
+
+	void _update_frame();
+	void _apply_frame(int p_frame);
+	int _get_keyframe(int p_frame) const;
+
+	void _set_size(const Vector2 &p_size);
+	Vector2 _get_size() const;
+	void _set_frame_rects(const Array &p_rects);
+	Array _get_frame_rects() const { return frame_rects; }
+	void _set_frame_data(const Array &p_data);
+	Array _get_frame_data() const { return frame_data; }
+	void _set_keyframes(const PoolIntArray &p_keyframes);
+	PoolIntArray _get_keyframes() const { return keyframes; }
+
+protected:
+	static void _bind_methods();
+
+public:
+	void create(int p_width, int p_height);
+	// p_data is the PNG packed rect of the frame, empty when nothing changed.
+	void add_frame(const Rect2 &p_rect, const PoolVector<uint8_t> &p_data, bool p_keyframe);
+	int get_frame_count() const;
+
+	void set_frame_rate(float p_frame_rate);
+	float get_frame_rate() const;
+	void set_playing(bool p_playing);
+	bool is_playing() const;
+	void set_loop(bool p_loop);
+	bool has_loop() const;
+	void set_current_frame(int p_frame);
+	int get_current_frame() const;
+
+	virtual int get_width() const;
+	virtual int get_height() const;
+	virtual RID get_rid() const;
+	virtual bool has_alpha() const;
+	virtual void set_flags(uint32_t p_flags);
+	virtual uint32_t get_flags() const;
+
+	LottieDeltaTexture();
+	~LottieDeltaTexture();
+};
+
+#endif // LOTTIE_DELTA_TEXTURE_H
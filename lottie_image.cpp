@@ -0,0 +1,195 @@
+/*************************************************************************/
+/*  lottie_image.cpp                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "lottie_image.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOTTIE_IMAGE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define LOTTIE_IMAGE_NEON
+#include <arm_neon.h>
+#endif
+
+// 8.24 fixed point 255 / alpha, so unpremultiplying is a multiply per channel.
+// The vector paths use the same ratio as a float, four lanes at a time.
+struct UnpremultiplyTable {
+	uint32_t factor[256];
+	float scale[256];
+
+	UnpremultiplyTable() {
+		factor[0] = 0;
+		scale[0] = 0;
+		for (uint32_t alpha = 1; alpha < 256; alpha++) {
+			factor[alpha] = uint32_t(((uint64_t(255) << 24) + alpha / 2) / alpha);
+			scale[alpha] = 255.0f / alpha;
+		}
+	}
+};
+
+static const UnpremultiplyTable unpremultiply_table;
+
+// Added before truncating a scaled channel. Past the half it rounds exact
+// halves up like the scalar path, and it stays below the 1 / 510 that any
+// other quotient of 255 * channel / alpha keeps from a half.
+#define LOTTIE_UNPREMULTIPLY_BIAS (0.5f + 1.0f / 1024.0f)
+
+static _FORCE_INLINE_ uint32_t _unpremultiply_channel(uint32_t p_channel, uint32_t p_factor) {
+	// The extra 1 << 12 makes exact halves round up despite the rounded factor.
+	uint32_t channel = uint32_t((uint64_t(p_channel) * p_factor + (1 << 23) + (1 << 12)) >> 24);
+	return channel > 255 ? 255 : channel;
+}
+
+static _FORCE_INLINE_ uint32_t _convert_pixel(uint32_t p_pixel) {
+	uint32_t alpha = p_pixel >> 24;
+	if (alpha == 255) {
+		return (p_pixel & 0xff00ff00) | ((p_pixel >> 16) & 0xff) | ((p_pixel & 0xff) << 16);
+	}
+	if (alpha == 0) {
+		return 0;
+	}
+	uint32_t factor = unpremultiply_table.factor[alpha];
+	uint32_t red = _unpremultiply_channel((p_pixel >> 16) & 0xff, factor);
+	uint32_t green = _unpremultiply_channel((p_pixel >> 8) & 0xff, factor);
+	uint32_t blue = _unpremultiply_channel(p_pixel & 0xff, factor);
+	return (alpha << 24) | (blue << 16) | (green << 8) | red;
+}
+
+#ifdef LOTTIE_IMAGE_SSE2
+static _FORCE_INLINE_ __m128i _unpremultiply_channels(__m128i p_channels, __m128 p_scale) {
+	__m128 channels = _mm_mul_ps(_mm_cvtepi32_ps(p_channels), p_scale);
+	channels = _mm_min_ps(_mm_add_ps(channels, _mm_set1_ps(LOTTIE_UNPREMULTIPLY_BIAS)), _mm_set1_ps(255.0f));
+	return _mm_cvttps_epi32(channels);
+}
+#endif
+
+#ifdef LOTTIE_IMAGE_NEON
+static _FORCE_INLINE_ uint32x4_t _unpremultiply_channels(uint32x4_t p_channels, float32x4_t p_scale) {
+	float32x4_t channels = vmulq_f32(vcvtq_f32_u32(p_channels), p_scale);
+	channels = vminq_f32(vaddq_f32(channels, vdupq_n_f32(LOTTIE_UNPREMULTIPLY_BIAS)), vdupq_n_f32(255.0f));
+	return vcvtq_u32_f32(channels);
+}
+#endif
+
+void lottie_convert_to_rgba8(uint32_t *p_pixels, int64_t p_pixel_count) {
+	int64_t pixel_i = 0;
+	// Four pixels at a time. Blocks that are all opaque only swap red and
+	// blue, and all transparent ones are cleared. Any other block scales its
+	// channels by the ratio of each pixel's alpha, looked up per lane.
+#if defined(LOTTIE_IMAGE_SSE2)
+	const __m128i alpha_mask = _mm_set1_epi32(0xff000000);
+	const __m128i alpha_green_mask = _mm_set1_epi32(0xff00ff00);
+	const __m128i channel_mask = _mm_set1_epi32(0xff);
+	const __m128i zero = _mm_setzero_si128();
+	for (; pixel_i + 4 <= p_pixel_count; pixel_i += 4) {
+		uint32_t *block = p_pixels + pixel_i;
+		__m128i pixels = _mm_loadu_si128((__m128i *)block);
+		__m128i alpha = _mm_and_si128(pixels, alpha_mask);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alpha_mask)) == 0xffff) {
+			__m128i red = _mm_and_si128(_mm_srli_epi32(pixels, 16), channel_mask);
+			__m128i blue = _mm_slli_epi32(_mm_and_si128(pixels, channel_mask), 16);
+			pixels = _mm_or_si128(_mm_and_si128(pixels, alpha_green_mask), _mm_or_si128(red, blue));
+			_mm_storeu_si128((__m128i *)block, pixels);
+		} else if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xffff) {
+			_mm_storeu_si128((__m128i *)block, zero);
+		} else {
+			const float *scale_table = unpremultiply_table.scale;
+			__m128 scale = _mm_setr_ps(scale_table[block[0] >> 24], scale_table[block[1] >> 24], scale_table[block[2] >> 24], scale_table[block[3] >> 24]);
+			__m128i red = _unpremultiply_channels(_mm_and_si128(_mm_srli_epi32(pixels, 16), channel_mask), scale);
+			__m128i green = _unpremultiply_channels(_mm_and_si128(_mm_srli_epi32(pixels, 8), channel_mask), scale);
+			__m128i blue = _unpremultiply_channels(_mm_and_si128(pixels, channel_mask), scale);
+			pixels = _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(blue, 16)), _mm_or_si128(_mm_slli_epi32(green, 8), red));
+			_mm_storeu_si128((__m128i *)block, pixels);
+		}
+	}
+#elif defined(LOTTIE_IMAGE_NEON)
+	// Byte order of every pixel with red and blue swapped.
+	static const uint8_t swap_red_blue[16] = { 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 };
+	const uint8x16_t swap_indices = vld1q_u8(swap_red_blue);
+	const uint32x4_t channel_mask = vdupq_n_u32(0xff);
+	for (; pixel_i + 4 <= p_pixel_count; pixel_i += 4) {
+		uint32_t *block = p_pixels + pixel_i;
+		uint32x4_t pixels = vld1q_u32(block);
+		uint32x4_t alpha = vshrq_n_u32(pixels, 24);
+		if (vminvq_u32(alpha) == 255) {
+			pixels = vreinterpretq_u32_u8(vqtbl1q_u8(vreinterpretq_u8_u32(pixels), swap_indices));
+			vst1q_u32(block, pixels);
+		} else if (vmaxvq_u32(alpha) == 0) {
+			vst1q_u32(block, vdupq_n_u32(0));
+		} else {
+			const float *scale_table = unpremultiply_table.scale;
+			const float block_scale[4] = { scale_table[block[0] >> 24], scale_table[block[1] >> 24], scale_table[block[2] >> 24], scale_table[block[3] >> 24] };
+			float32x4_t scale = vld1q_f32(block_scale);
+			uint32x4_t red = _unpremultiply_channels(vandq_u32(vshrq_n_u32(pixels, 16), channel_mask), scale);
+			uint32x4_t green = _unpremultiply_channels(vandq_u32(vshrq_n_u32(pixels, 8), channel_mask), scale);
+			uint32x4_t blue = _unpremultiply_channels(vandq_u32(pixels, channel_mask), scale);
+			pixels = vorrq_u32(vorrq_u32(vshlq_n_u32(alpha, 24), vshlq_n_u32(blue, 16)), vorrq_u32(vshlq_n_u32(green, 8), red));
+			vst1q_u32(block, pixels);
+		}
+	}
+#endif
+	for (; pixel_i < p_pixel_count; pixel_i++) {
+		p_pixels[pixel_i] = _convert_pixel(p_pixels[pixel_i]);
+	}
+}
+
+// Unchanged rows are skipped with memcmp, only changed rows are scanned for
+// their first and last changed pixel.
+Rect2 lottie_get_dirty_rect(const uint32_t *p_previous, const uint32_t *p_pixels, int32_t p_width, int32_t p_height) {
+	int32_t min_x = p_width;
+	int32_t min_y = p_height;
+	int32_t max_x = -1;
+	int32_t max_y = -1;
+	for (int32_t y = 0; y < p_height; y++) {
+		const uint32_t *previous_row = p_previous + y * p_width;
+		const uint32_t *row = p_pixels + y * p_width;
+		if (!memcmp(previous_row, row, p_width * sizeof(uint32_t))) {
+			continue;
+		}
+		int32_t left = 0;
+		while (previous_row[left] == row[left]) {
+			left++;
+		}
+		int32_t right = p_width - 1;
+		while (previous_row[right] == row[right]) {
+			right--;
+		}
+		min_x = MIN(min_x, left);
+		max_x = MAX(max_x, right);
+		min_y = MIN(min_y, y);
+		max_y = y;
+	}
+	if (max_y < 0) {
+		return Rect2();
+	}
+	return Rect2(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1);
+}
@@ -0,0 +1,45 @@
+/*************************************************************************/
+/*  lottie_image.h                                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef LOTTIE_IMAGE_H
+#define LOTTIE_IMAGE_H
+
+#include "core/math/rect2.h"
+#include "core/typedefs.h"
+
+// rlottie renders ARGB32_Premultiplied, which is BGRA in memory on little
+// endian. Godot expects straight alpha RGBA8, so the frame is swizzled and
+// unpremultiplied in place.
+void lottie_convert_to_rgba8(uint32_t *p_pixels, int64_t p_pixel_count);
+
+// Returns the bounds of the pixels that differ between two frames, empty when
+// they are identical.
+Rect2 lottie_get_dirty_rect(const uint32_t *p_previous, const uint32_t *p_pixels, int32_t p_width, int32_t p_height);
+
+#endif // LOTTIE_IMAGE_H
@@ -0,0 +1,342 @@
+/*************************************************************************/
+/*  lottie_mesh.cpp                                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "lottie_mesh.h"
+
+#include "core/list.h"
+#include "core/math/geometry.h"
+#include "scene/resources/mesh.h"
+
+#include "thirdparty/misc/triangulator.h"
+
+// Largest distance in pixels between a curve and the lines it is flattened
+// into.
+#define LOTTIE_MESH_TOLERANCE 0.25
+#define LOTTIE_MESH_MAX_SEGMENTS 64
+
+// Same order as VPath::Element.
+enum PathElement {
+	PATH_MOVE_TO,
+	PATH_LINE_TO,
+	PATH_CUBIC_TO,
+	PATH_CLOSE,
+};
+
+struct MeshContour {
+	Vector<Vector2> points;
+	bool closed = false;
+};
+
+struct MeshBuilder {
+	Vector<Vector2> vertices;
+	Vector<Color> colors;
+	bool unsupported = false;
+};
+
+static void _add_point(MeshContour &r_contour, const Vector2 &p_point) {
+	int32_t point_count = r_contour.points.size();
+	if (!point_count || r_contour.points[point_count - 1].distance_squared_to(p_point) > CMP_EPSILON2) {
+		r_contour.points.push_back(p_point);
+	}
+}
+
+static void _end_contour(Vector<MeshContour> &r_contours, MeshContour &r_contour) {
+	int32_t point_count = r_contour.points.size();
+	if (point_count > 2 && r_contour.points[0].distance_squared_to(r_contour.points[point_count - 1]) <= CMP_EPSILON2) {
+		r_contour.points.resize(point_count - 1);
+		r_contour.closed = true;
+	}
+	if (r_contour.points.size() > 1) {
+		r_contours.push_back(r_contour);
+	}
+	r_contour = MeshContour();
+}
+
+static Vector2 _get_bezier_point(const Vector2 &p_start, const Vector2 &p_control_1, const Vector2 &p_control_2, const Vector2 &p_end, real_t p_t) {
+	real_t u = 1 - p_t;
+	return p_start * (u * u * u) + p_control_1 * (3 * u * u * p_t) + p_control_2 * (3 * u * p_t * p_t) + p_end * (p_t * p_t * p_t);
+}
+
+// Splits a path into polylines, curves get enough segments to stay within
+// LOTTIE_MESH_TOLERANCE of the curve.
+static Vector<MeshContour> _flatten_path(const float *p_points, size_t p_float_count, const char *p_elements, size_t p_element_count) {
+	Vector<MeshContour> contours;
+	MeshContour contour;
+	Vector2 last;
+	size_t float_i = 0;
+	for (size_t element_i = 0; element_i < p_element_count; element_i++) {
+		switch (p_elements[element_i]) {
+			case PATH_MOVE_TO: {
+				ERR_FAIL_COND_V(float_i + 2 > p_float_count, contours);
+				_end_contour(contours, contour);
+				last = Vector2(p_points[float_i], p_points[float_i + 1]);
+				float_i += 2;
+				_add_point(contour, last);
+			} break;
+			case PATH_LINE_TO: {
+				ERR_FAIL_COND_V(float_i + 2 > p_float_count, contours);
+				last = Vector2(p_points[float_i], p_points[float_i + 1]);
+				float_i += 2;
+				_add_point(contour, last);
+			} break;
+			case PATH_CUBIC_TO: {
+				ERR_FAIL_COND_V(float_i + 6 > p_float_count, contours);
+				Vector2 control_1(p_points[float_i], p_points[float_i + 1]);
+				Vector2 control_2(p_points[float_i + 2], p_points[float_i + 3]);
+				Vector2 end(p_points[float_i + 4], p_points[float_i + 5]);
+				float_i += 6;
+				// Wang's formula for the segment count of a cubic.
+				real_t deviation = MAX((last - control_1 * 2 + control_2).length(), (control_1 - control_2 * 2 + end).length());
+				int32_t segments = CLAMP((int32_t)Math::ceil(Math::sqrt(0.75 * deviation / LOTTIE_MESH_TOLERANCE)), 1, LOTTIE_MESH_MAX_SEGMENTS);
+				for (int32_t segment_i = 1; segment_i <= segments; segment_i++) {
+					_add_point(contour, _get_bezier_point(last, control_1, control_2, end, real_t(segment_i) / segments));
+				}
+				last = end;
+			} break;
+			case PATH_CLOSE: {
+				contour.closed = true;
+				_end_contour(contours, contour);
+			} break;
+		}
+	}
+	_end_contour(contours, contour);
+	return contours;
+}
+
+// Polygons inside an odd number of others are holes, which matches the even
+// odd fill rule and the usual non zero winding artwork where holes run the
+// other way.
+static void _triangulate(const Vector<Vector<Vector2> > &p_polygons, Vector<Vector2> &r_triangles) {
+	List<TriangulatorPoly> in_polygons;
+	for (int32_t polygon_i = 0; polygon_i < p_polygons.size(); polygon_i++) {
+		const Vector<Vector2> &polygon = p_polygons[polygon_i];
+		if (polygon.size() < 3) {
+			continue;
+		}
+		int32_t depth = 0;
+		for (int32_t other_i = 0; other_i < p_polygons.size(); other_i++) {
+			if (other_i != polygon_i && p_polygons[other_i].size() > 2 && Geometry::is_point_in_polygon(polygon[0], p_polygons[other_i])) {
+				depth++;
+			}
+		}
+		TriangulatorPoly in_polygon;
+		in_polygon.Init(polygon.size());
+		for (int32_t point_i = 0; point_i < polygon.size(); point_i++) {
+			in_polygon[point_i] = polygon[point_i];
+		}
+		bool hole = depth % 2;
+		in_polygon.SetOrientation(hole ? TRIANGULATOR_CW : TRIANGULATOR_CCW);
+		in_polygon.SetHole(hole);
+		in_polygons.push_back(in_polygon);
+	}
+	if (in_polygons.empty()) {
+		return;
+	}
+
+	List<TriangulatorPoly> triangles;
+	TriangulatorPartition partition;
+	if (partition.Triangulate_EC(&in_polygons, &triangles)) {
+		for (List<TriangulatorPoly>::Element *E = triangles.front(); E; E = E->next()) {
+			for (int32_t point_i = 0; point_i < 3; point_i++) {
+				r_triangles.push_back(E->get()[point_i]);
+			}
+		}
+		return;
+	}
+	// Self intersecting outlines can not be split with their holes, their
+	// outer polygons are filled on their own instead.
+	for (List<TriangulatorPoly>::Element *E = in_polygons.front(); E; E = E->next()) {
+		if (E->get().IsHole()) {
+			continue;
+		}
+		Vector<Vector2> polygon;
+		for (int32_t point_i = 0; point_i < E->get().GetNumPoints(); point_i++) {
+			polygon.push_back(E->get()[point_i]);
+		}
+		Vector<int> indices = Geometry::triangulate_polygon(polygon);
+		for (int32_t index_i = 0; index_i < indices.size(); index_i++) {
+			r_triangles.push_back(polygon[indices[index_i]]);
+		}
+	}
+}
+
+static Color _get_color(uint8_t p_red, uint8_t p_green, uint8_t p_blue, uint8_t p_alpha) {
+	return Color(p_red / 255.0, p_green / 255.0, p_blue / 255.0, p_alpha / 255.0);
+}
+
+// Vertex colors only approximate gradients, they are exact at the vertices.
+static Color _get_gradient_color(const LOTNode *p_node, const Vector2 &p_point) {
+	size_t stop_count = p_node->mGradient.stopCount;
+	const LOTGradientStop *stops = p_node->mGradient.stopPtr;
+	if (!stop_count) {
+		return Color(0, 0, 0, 0);
+	}
+	real_t t = 0;
+	if (p_node->mGradient.type == GradientLinear) {
+		Vector2 start(p_node->mGradient.start.x, p_node->mGradient.start.y);
+		Vector2 end(p_node->mGradient.end.x, p_node->mGradient.end.y);
+		real_t length_squared = start.distance_squared_to(end);
+		if (length_squared > CMP_EPSILON2) {
+			t = (p_point - start).dot(end - start) / length_squared;
+		}
+	} else if (p_node->mGradient.cradius > CMP_EPSILON) {
+		Vector2 center(p_node->mGradient.center.x, p_node->mGradient.center.y);
+		t = p_point.distance_to(center) / p_node->mGradient.cradius;
+	}
+	t = CLAMP(t, 0, 1);
+	size_t stop_i = 0;
+	while (stop_i + 1 < stop_count && stops[stop_i + 1].pos < t) {
+		stop_i++;
+	}
+	const LOTGradientStop &from = stops[stop_i];
+	const LOTGradientStop &to = stops[MIN(stop_i + 1, stop_count - 1)];
+	real_t weight = to.pos > from.pos ? CLAMP((t - from.pos) / (to.pos - from.pos), 0, 1) : 0;
+	return _get_color(from.r, from.g, from.b, from.a).linear_interpolate(_get_color(to.r, to.g, to.b, to.a), weight);
+}
+
+static void _add_node(const LOTNode *p_node, real_t p_alpha, MeshBuilder &r_builder) {
+	if (p_node->mImageInfo.data) {
+		r_builder.unsupported = true;
+		return;
+	}
+	Vector<MeshContour> contours = _flatten_path(p_node->mPath.ptPtr, p_node->mPath.ptCount, p_node->mPath.elmPtr, p_node->mPath.elmCount);
+	Vector<Vector<Vector2> > polygons;
+	if (p_node->mStroke.enable) {
+		Geometry::PolyJoinType join = Geometry::JOIN_MITER;
+		if (p_node->mStroke.join == JoinRound) {
+			join = Geometry::JOIN_ROUND;
+		} else if (p_node->mStroke.join == JoinBevel) {
+			join = Geometry::JOIN_SQUARE;
+		}
+		Geometry::PolyEndType end = Geometry::END_BUTT;
+		if (p_node->mStroke.cap == CapRound) {
+			end = Geometry::END_ROUND;
+		} else if (p_node->mStroke.cap == CapSquare) {
+			end = Geometry::END_SQUARE;
+		}
+		for (int32_t contour_i = 0; contour_i < contours.size(); contour_i++) {
+			const MeshContour &contour = contours[contour_i];
+			Vector<Vector<Vector2> > outlines = Geometry::offset_polyline_2d(contour.points, p_node->mStroke.width * 0.5, join, contour.closed ? Geometry::END_JOINED : end);
+			for (int32_t outline_i = 0; outline_i < outlines.size(); outline_i++) {
+				polygons.push_back(outlines[outline_i]);
+			}
+		}
+	} else {
+		for (int32_t contour_i = 0; contour_i < contours.size(); contour_i++) {
+			polygons.push_back(contours[contour_i].points);
+		}
+	}
+
+	Vector<Vector2> triangles;
+	_triangulate(polygons, triangles);
+	Color color = _get_color(p_node->mColor.r, p_node->mColor.g, p_node->mColor.b, p_node->mColor.a);
+	for (int32_t vertex_i = 0; vertex_i < triangles.size(); vertex_i++) {
+		Color vertex_color = p_node->mBrushType == BrushGradient ? _get_gradient_color(p_node, triangles[vertex_i]) : color;
+		vertex_color.a *= p_alpha;
+		r_builder.vertices.push_back(triangles[vertex_i]);
+		r_builder.colors.push_back(vertex_color);
+	}
+}
+
+// Layers are listed back to front, a matted layer is followed by its matte
+// source.
+static void _add_layer(const LOTLayerNode *p_layer, real_t p_alpha, MeshBuilder &r_builder) {
+	if (!p_layer->mVisible) {
+		return;
+	}
+	real_t alpha = p_alpha * p_layer->mAlpha / 255.0;
+	if (p_layer->mMaskList.size) {
+		r_builder.unsupported = true;
+	}
+	for (size_t layer_i = 0; layer_i < p_layer->mLayerList.size; layer_i++) {
+		const LOTLayerNode *layer = p_layer->mLayerList.ptr[layer_i];
+		_add_layer(layer, alpha, r_builder);
+		if (layer->mMatte != MatteNone) {
+			r_builder.unsupported = true;
+			layer_i++;
+		}
+	}
+	for (size_t node_i = 0; node_i < p_layer->mNodeList.size; node_i++) {
+		_add_node(p_layer->mNodeList.ptr[node_i], alpha, r_builder);
+	}
+}
+
+Array lottie_get_mesh_arrays(const LOTLayerNode *p_root, const Size2 &p_size, bool p_3d, bool *r_unsupported) {
+	ERR_FAIL_COND_V(!p_root, Array());
+	MeshBuilder builder;
+	_add_layer(p_root, 1, builder);
+	if (r_unsupported) {
+		*r_unsupported = builder.unsupported;
+	}
+	int32_t vertex_count = builder.vertices.size();
+	if (!vertex_count) {
+		return Array();
+	}
+
+	Array arrays;
+	arrays.resize(Mesh::ARRAY_MAX);
+	Vector2 center = p_size * 0.5;
+	if (p_3d) {
+		// Same size and orientation as a Sprite3D with the default pixel size.
+		PoolVector3Array vertices;
+		PoolVector3Array normals;
+		vertices.resize(vertex_count);
+		normals.resize(vertex_count);
+		PoolVector3Array::Write vertices_write = vertices.write();
+		PoolVector3Array::Write normals_write = normals.write();
+		for (int32_t vertex_i = 0; vertex_i < vertex_count; vertex_i++) {
+			Vector2 vertex = builder.vertices[vertex_i] - center;
+			vertices_write[vertex_i] = Vector3(vertex.x, -vertex.y, 0) * 0.01;
+			normals_write[vertex_i] = Vector3(0, 0, 1);
+		}
+		vertices_write = PoolVector3Array::Write();
+		normals_write = PoolVector3Array::Write();
+		arrays[Mesh::ARRAY_VERTEX] = vertices;
+		arrays[Mesh::ARRAY_NORMAL] = normals;
+	} else {
+		PoolVector2Array vertices;
+		vertices.resize(vertex_count);
+		PoolVector2Array::Write vertices_write = vertices.write();
+		for (int32_t vertex_i = 0; vertex_i < vertex_count; vertex_i++) {
+			vertices_write[vertex_i] = builder.vertices[vertex_i] - center;
+		}
+		vertices_write = PoolVector2Array::Write();
+		arrays[Mesh::ARRAY_VERTEX] = vertices;
+	}
+	PoolColorArray colors;
+	colors.resize(vertex_count);
+	PoolColorArray::Write colors_write = colors.write();
+	for (int32_t vertex_i = 0; vertex_i < vertex_count; vertex_i++) {
+		colors_write[vertex_i] = builder.colors[vertex_i];
+	}
+	colors_write = PoolColorArray::Write();
+	arrays[Mesh::ARRAY_COLOR] = colors;
+	return arrays;
+}
@@ -0,0 +1,280 @@
+/*************************************************************************/
+/*  lottie_player.cpp                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "lottie_player.h"
+
+#include "core/math/math_funcs.h"
+#include "core/os/file_access.h"
+#include "lottie_image.h"
+#include "servers/visual_server.h"
+
+#include <chrono>
+
+Error LottiePlayback::load(const String &p_path, const Vector2 &p_scale) {
+	clear();
+	// Parsed in place, the buffer only needs a null after the content.
+	Vector<uint8_t> json = FileAccess::get_file_as_array(p_path);
+	ERR_FAIL_COND_V(!json.size(), ERR_FILE_CANT_OPEN);
+	json.push_back(0);
+	std::string key = (p_path + ":" + FileAccess::get_md5(p_path)).utf8().get_data();
+	lottie = rlottie::Animation::loadFromBuffer((char *)json.ptrw(), key);
+	ERR_FAIL_COND_V(!lottie, ERR_PARSE_ERROR);
+	size_t lottie_width = 0;
+	size_t lottie_height = 0;
+	lottie->size(lottie_width, lottie_height);
+	width = lottie_width * p_scale.width;
+	height = lottie_height * p_scale.height;
+	if (width <= 0 || height <= 0 || !get_frame_count()) {
+		lottie.reset();
+		ERR_FAIL_V(ERR_INVALID_DATA);
+	}
+	// Playback waits on one frame at a time, a large frame is split into
+	// bands that blend on all render threads.
+	lottie->setTiledRendering(true);
+	texture.instance();
+	// The texture is rewritten on most frames, let the driver treat it as a
+	// streamed surface.
+	texture->create(width, height, Image::FORMAT_RGBA8, Texture::FLAG_FILTER | Texture::FLAG_VIDEO_SURFACE);
+	set_frame(0);
+	return OK;
+}
+
+void LottiePlayback::clear() {
+	if (render.valid()) {
+		render_token->cancel();
+		render.wait();
+	}
+	render = std::future<rlottie::Surface>();
+	render_token.reset();
+	lottie.reset();
+	buffer_write.release();
+	buffer = PoolByteArray();
+	texture.unref();
+	cache.clear();
+	cache_lru.clear();
+	cache_bytes = 0;
+	rendering_frame = -1;
+	wanted_frame = -1;
+	shown_frame = -1;
+	shown_image.unref();
+	time = 0;
+}
+
+int LottiePlayback::get_frame_count() const {
+	if (!lottie) {
+		return 0;
+	}
+	return lottie->totalFrame();
+}
+
+float LottiePlayback::get_frame_rate() const {
+	if (!lottie) {
+		return 0;
+	}
+	return lottie->frameRate();
+}
+
+void LottiePlayback::set_frame(int p_frame) {
+	if (!lottie) {
+		return;
+	}
+	wanted_frame = CLAMP(p_frame, 0, get_frame_count() - 1);
+	time = wanted_frame / get_frame_rate();
+	process(0);
+}
+
+void LottiePlayback::set_cache_budget(int64_t p_bytes) {
+	cache_budget = MAX(p_bytes, 0);
+	_trim_cache();
+}
+
+void LottiePlayback::_start_render(int p_frame, rlottie::RenderPriority p_priority) {
+	rendering_frame = p_frame;
+	int64_t buffer_byte_size = int64_t(width) * height * 4;
+	if (buffer.size() != buffer_byte_size) {
+		buffer.resize(buffer_byte_size);
+	}
+	buffer_write = buffer.write();
+	rlottie::Surface surface((uint32_t *)buffer_write.ptr(), width, height, width * 4);
+	render_token = std::make_shared<rlottie::CancellationToken>();
+	render = lottie->render(p_frame, surface, render_token, true, p_priority);
+}
+
+void LottiePlayback::_show_frame(int p_frame, const Ref<Image> &p_image) {
+	// Only the rect that changed since the shown frame is uploaded, nothing at
+	// all when they are the same. Uploads are what limits slow devices.
+	if (shown_image.is_null()) {
+		texture->set_data(p_image);
+	} else {
+		PoolByteArray shown_pixels = shown_image->get_data();
+		PoolByteArray pixels = p_image->get_data();
+		PoolByteArray::Read shown_read = shown_pixels.read();
+		PoolByteArray::Read read = pixels.read();
+		Rect2 rect = lottie_get_dirty_rect((const uint32_t *)shown_read.ptr(), (const uint32_t *)read.ptr(), width, height);
+		if (!rect.has_no_area()) {
+			VS::get_singleton()->texture_set_data_partial(texture->get_rid(), p_image, rect.position.x, rect.position.y, rect.size.width, rect.size.height, rect.position.x, rect.position.y, 0);
+		}
+	}
+	shown_image = p_image;
+	shown_frame = p_frame;
+}
+
+bool LottiePlayback::_cache_frame(int p_frame, const Ref<Image> &p_image) {
+	int64_t frame_bytes = int64_t(width) * height * 4;
+	if (frame_bytes > cache_budget || cache.has(p_frame)) {
+		return false;
+	}
+	CachedFrame cached;
+	cached.image = p_image;
+	cached.lru = cache_lru.push_front(p_frame);
+	cache.insert(p_frame, cached);
+	cache_bytes += frame_bytes;
+	_trim_cache();
+	return true;
+}
+
+void LottiePlayback::_trim_cache() {
+	int64_t frame_bytes = int64_t(width) * height * 4;
+	while (cache_bytes > cache_budget && cache_lru.size()) {
+		cache.erase(cache_lru.back()->get());
+		cache_lru.pop_back();
+		cache_bytes -= frame_bytes;
+	}
+}
+
+Ref<Image> LottiePlayback::_get_cached_frame(int p_frame) {
+	Map<int, CachedFrame>::Element *E = cache.find(p_frame);
+	if (!E) {
+		return Ref<Image>();
+	}
+	cache_lru.move_to_front(E->get().lru);
+	return E->get().image;
+}
+
+bool LottiePlayback::process(float p_delta) {
+	if (!lottie) {
+		return false;
+	}
+	bool finished = false;
+	int frame_count = get_frame_count();
+	if (playing && p_delta != 0) {
+		float length = frame_count / get_frame_rate();
+		time += p_delta * speed_scale;
+		if (time >= length || time < 0) {
+			if (loop) {
+				time = Math::fposmod(time, length);
+			} else {
+				time = CLAMP(time, 0, length);
+				playing = false;
+				finished = true;
+			}
+		}
+		wanted_frame = CLAMP(int(time * get_frame_rate()), 0, frame_count - 1);
+	}
+
+	// A frame that is neither wanted nor the one right after it won't be
+	// shown any time soon, it only keeps the wanted frame waiting.
+	if (render.valid() && rendering_frame != wanted_frame && rendering_frame != (wanted_frame + 1) % frame_count) {
+		render_token->cancel();
+	}
+	if (render.valid() && render.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		rlottie::Surface rendered = render.get();
+		if (rendered.buffer()) {
+			lottie_convert_to_rgba8((uint32_t *)buffer_write.ptr(), int64_t(width) * height);
+			buffer_write.release();
+			Ref<Image> image;
+			image.instance();
+			image->create(width, height, false, Image::FORMAT_RGBA8, buffer);
+			// A cached image owns the buffer now, otherwise the next frame
+			// renders into the same memory.
+			if (_cache_frame(rendering_frame, image)) {
+				buffer = PoolByteArray();
+			}
+			if (rendering_frame == wanted_frame) {
+				_show_frame(rendering_frame, image);
+			}
+		} else {
+			buffer_write.release();
+		}
+		render_token.reset();
+		rendering_frame = -1;
+	}
+
+	if (wanted_frame != shown_frame) {
+		Ref<Image> cached = _get_cached_frame(wanted_frame);
+		if (cached.is_valid()) {
+			_show_frame(wanted_frame, cached);
+		}
+	}
+	if (render.valid()) {
+		return finished;
+	}
+	if (wanted_frame != shown_frame) {
+		_start_render(wanted_frame, rlottie::RenderPriority::Frame);
+	} else if (playing && int64_t(width) * height * 4 <= cache_budget) {
+		// Nothing to wait for, render the frame playback reaches next.
+		int next_frame = wanted_frame + 1;
+		if (next_frame >= frame_count) {
+			next_frame = loop ? 0 : -1;
+		}
+		if (next_frame != -1 && !cache.has(next_frame)) {
+			_start_render(next_frame, rlottie::RenderPriority::Background);
+		}
+	}
+	return finished;
+}
+
+LottiePlayback::~LottiePlayback() {
+	clear();
+}
+
+void LottiePlayer::_validate_property(PropertyInfo &property) const {
+	Sprite::_validate_property(property);
+	// The texture belongs to the player and is rewritten every frame.
+	if (property.name == "texture" || property.name == "normal_map" || property.name == "hframes" || property.name == "vframes" || property.name == "frame" || property.name == "frame_coords" || property.name.begins_with("region")) {
+		property.usage = 0;
+	}
+}
+
+void LottiePlayer::_bind_methods() {
+	_bind_player_methods<LottiePlayer>();
+}
+
+void LottiePlayer3D::_validate_property(PropertyInfo &property) const {
+	Sprite3D::_validate_property(property);
+	// The texture belongs to the player and is rewritten every frame.
+	if (property.name == "texture" || property.name == "hframes" || property.name == "vframes" || property.name == "frame" || property.name == "frame_coords" || property.name.begins_with("region")) {
+		property.usage = 0;
+	}
+}
+
+void LottiePlayer3D::_bind_methods() {
+	_bind_player_methods<LottiePlayer3D>();
+}
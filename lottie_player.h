@@ -0,0 +1,248 @@
+/*************************************************************************/
+/*  lottie_player.h                                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+#ifndef LOTTIE_PLAYER_H
+#define LOTTIE_PLAYER_H
+
+#include "core/list.h"
+#include "core/map.h"
+#include "scene/2d/sprite.h"
+#include "scene/3d/sprite_3d.h"
+
+#include "thirdparty/rlottie/inc/rlottie.h"
+
+// Renders the frames of one Lottie file on demand instead of baking them at
+// import. Frames render asynchronously on the rlottie scheduler and only the
+// rect that changed since the shown frame is uploaded into a single texture.
+// A render is cancelled once playback moved past its frame.
+// Recently shown frames are kept in an LRU cache bounded by a byte budget, so
+// memory does not grow with the length of the animation.
+class LottiePlayback {
+	struct CachedFrame {
+		Ref<Image> image;
+		List<int>::Element *lru = nullptr;
+	};
+
+	std::unique_ptr<rlottie::Animation> lottie;
+	PoolByteArray buffer;
+	PoolByteArray::Write buffer_write;
+	std::future<rlottie::Surface> render;
+	std::shared_ptr<rlottie::CancellationToken> render_token;
+	int rendering_frame = -1;
+	int wanted_frame = -1;
+	int shown_frame = -1;
+	Ref<Image> shown_image;
+	int width = 0;
+	int height = 0;
+	Ref<ImageTexture> texture;
+
+	Map<int, CachedFrame> cache;
+	List<int> cache_lru;
+	int64_t cache_budget = 32 * 1024 * 1024;
+	int64_t cache_bytes = 0;
+
+	float time = 0;
+	float speed_scale = 1;
+	bool playing = false;
+	bool loop = true;
+
+	void _start_render(int p_frame, rlottie::RenderPriority p_priority);
+	void _show_frame(int p_frame, const Ref<Image> &p_image);
+	bool _cache_frame(int p_frame, const Ref<Image> &p_image);
+	void _trim_cache();
+	Ref<Image> _get_cached_frame(int p_frame);
+
+public:
+	Error load(const String &p_path, const Vector2 &p_scale);
+	void clear();
+	bool is_loaded() const { return bool(lottie); }
+
+	Ref<ImageTexture> get_texture() const { return texture; }
+	int get_frame_count() const;
+	float get_frame_rate() const;
+
+	void set_frame(int p_frame);
+	int get_frame() const { return wanted_frame; }
+
+	void set_cache_budget(int64_t p_bytes);
+	int64_t get_cache_budget() const { return cache_budget; }
+	int64_t get_cache_usage() const { return cache_bytes; }
+
+	void set_playing(bool p_playing) { playing = p_playing; }
+	bool is_playing() const { return playing; }
+	void set_loop(bool p_loop) { loop = p_loop; }
+	bool has_loop() const { return loop; }
+	void set_speed_scale(float p_speed_scale) { speed_scale = p_speed_scale; }
+	float get_speed_scale() const { return speed_scale; }
+
+	// Advances playback by p_delta seconds and uploads any frame that finished
+	// rendering. Returns true when a non looping animation reached its end.
+	bool process(float p_delta);
+
+	~LottiePlayback();
+};
+
+// The node side of runtime playback shared by LottiePlayer and
+// LottiePlayer3D, T is the node class that shows the texture. Not registered
+// itself, the players bind its methods under their own class.
+template <class T>
+class LottiePlayerNode : public T {
+	// Methods are bound on the class their pointer belongs to, so they are
+	// converted to a pointer into the final player first.
+	template <class P, class R, class... A>
+	static auto _player_method(R (LottiePlayerNode::*p_method)(A...)) -> R (P::*)(A...) {
+		return p_method;
+	}
+	template <class P, class R, class... A>
+	static auto _player_method(R (LottiePlayerNode::*p_method)(A...) const) -> R (P::*)(A...) const {
+		return p_method;
+	}
+
+protected:
+	LottiePlayback playback;
+	String file;
+	Vector2 render_scale = Vector2(1, 1);
+
+	void _reload() {
+		playback.clear();
+		this->set_texture(Ref<Texture>());
+		if (file.empty()) {
+			return;
+		}
+		if (playback.load(file, render_scale) != OK) {
+			return;
+		}
+		this->set_texture(playback.get_texture());
+		this->_change_notify("current_frame");
+	}
+
+	void _notification(int p_what) {
+		switch (p_what) {
+			case Node::NOTIFICATION_READY: {
+				this->set_process_internal(true);
+			} break;
+			case Node::NOTIFICATION_INTERNAL_PROCESS: {
+				if (playback.process(this->get_process_delta_time())) {
+					this->_change_notify("playing");
+					this->emit_signal("animation_finished");
+				}
+			} break;
+		}
+	}
+
+	template <class P>
+	static void _bind_player_methods() {
+		ClassDB::bind_method(D_METHOD("set_file", "file"), _player_method<P>(&LottiePlayerNode::set_file));
+		ClassDB::bind_method(D_METHOD("get_file"), _player_method<P>(&LottiePlayerNode::get_file));
+		ClassDB::bind_method(D_METHOD("set_render_scale", "scale"), _player_method<P>(&LottiePlayerNode::set_render_scale));
+		ClassDB::bind_method(D_METHOD("get_render_scale"), _player_method<P>(&LottiePlayerNode::get_render_scale));
+		ClassDB::bind_method(D_METHOD("set_current_frame", "frame"), _player_method<P>(&LottiePlayerNode::set_current_frame));
+		ClassDB::bind_method(D_METHOD("get_current_frame"), _player_method<P>(&LottiePlayerNode::get_current_frame));
+		ClassDB::bind_method(D_METHOD("get_frame_count"), _player_method<P>(&LottiePlayerNode::get_frame_count));
+		ClassDB::bind_method(D_METHOD("set_playing", "playing"), _player_method<P>(&LottiePlayerNode::set_playing));
+		ClassDB::bind_method(D_METHOD("is_playing"), _player_method<P>(&LottiePlayerNode::is_playing));
+		ClassDB::bind_method(D_METHOD("set_loop", "loop"), _player_method<P>(&LottiePlayerNode::set_loop));
+		ClassDB::bind_method(D_METHOD("has_loop"), _player_method<P>(&LottiePlayerNode::has_loop));
+		ClassDB::bind_method(D_METHOD("set_speed_scale", "speed_scale"), _player_method<P>(&LottiePlayerNode::set_speed_scale));
+		ClassDB::bind_method(D_METHOD("get_speed_scale"), _player_method<P>(&LottiePlayerNode::get_speed_scale));
+		ClassDB::bind_method(D_METHOD("set_cache_budget", "bytes"), _player_method<P>(&LottiePlayerNode::set_cache_budget));
+		ClassDB::bind_method(D_METHOD("get_cache_budget"), _player_method<P>(&LottiePlayerNode::get_cache_budget));
+		ClassDB::bind_method(D_METHOD("play"), _player_method<P>(&LottiePlayerNode::play));
+		ClassDB::bind_method(D_METHOD("stop"), _player_method<P>(&LottiePlayerNode::stop));
+
+		const StringName player = P::get_class_static();
+		ClassDB::add_property(player, PropertyInfo(Variant::VECTOR2, "render_scale"), "set_render_scale", "get_render_scale");
+		ClassDB::add_property(player, PropertyInfo(Variant::STRING, "file", PROPERTY_HINT_FILE, "*.json"), "set_file", "get_file");
+		ClassDB::add_property(player, PropertyInfo(Variant::INT, "current_frame", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR), "set_current_frame", "get_current_frame");
+		ClassDB::add_property(player, PropertyInfo(Variant::BOOL, "playing"), "set_playing", "is_playing");
+		ClassDB::add_property(player, PropertyInfo(Variant::BOOL, "loop"), "set_loop", "has_loop");
+		ClassDB::add_property(player, PropertyInfo(Variant::REAL, "speed_scale"), "set_speed_scale", "get_speed_scale");
+		ClassDB::add_property(player, PropertyInfo(Variant::INT, "cache_budget", PROPERTY_HINT_RANGE, "0,1073741824,1,or_greater"), "set_cache_budget", "get_cache_budget");
+
+		ClassDB::add_signal(player, MethodInfo("animation_finished"));
+	}
+
+public:
+	void set_file(const String &p_file) {
+		file = p_file;
+		_reload();
+	}
+	String get_file() const { return file; }
+	void set_render_scale(const Vector2 &p_scale) {
+		render_scale = p_scale;
+		if (playback.is_loaded()) {
+			_reload();
+		}
+	}
+	Vector2 get_render_scale() const { return render_scale; }
+	void set_current_frame(int p_frame) { playback.set_frame(p_frame); }
+	int get_current_frame() const { return playback.get_frame(); }
+	int get_frame_count() const { return playback.get_frame_count(); }
+	void set_playing(bool p_playing) { playback.set_playing(p_playing); }
+	bool is_playing() const { return playback.is_playing(); }
+	void set_loop(bool p_loop) { playback.set_loop(p_loop); }
+	bool has_loop() const { return playback.has_loop(); }
+	void set_speed_scale(float p_speed_scale) { playback.set_speed_scale(p_speed_scale); }
+	float get_speed_scale() const { return playback.get_speed_scale(); }
+	void set_cache_budget(int64_t p_bytes) { playback.set_cache_budget(p_bytes); }
+	int64_t get_cache_budget() const { return playback.get_cache_budget(); }
+
+	void play() {
+		set_playing(true);
+		this->_change_notify("playing");
+	}
+	void stop() {
+		set_playing(false);
+		this->_change_notify("playing");
+	}
+};
+
+class LottiePlayer : public LottiePlayerNode<Sprite> {
+	GDCLASS(LottiePlayer, Sprite);
+
+protected:
+	virtual void _validate_property(PropertyInfo &property) const;
+	static void _bind_methods();
+
+public:
+	LottiePlayer() {}
+};
+
+class LottiePlayer3D : public LottiePlayerNode<Sprite3D> {
+	GDCLASS(LottiePlayer3D, Sprite3D);
+
+protected:
+	virtual void _validate_property(PropertyInfo &property) const;
+	static void _bind_methods();
+
+public:
+	LottiePlayer3D() {}
+};
+
+#endif // LOTTIE_PLAYER_H
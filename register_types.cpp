@@ -29,13 +29,34 @@
 /*************************************************************************/
 
 #include "register_types.h"
+#include "core/class_db.h"
 #include "core/io/resource_importer.h"
+#include "core/os/os.h"
+#include "core/project_settings.h"
+#include "lottie_batch_converter.h"
+#include "lottie_delta_texture.h"
+#include "lottie_player.h"
 #include "resource_importer_lottie.h"
 
 void register_lottie_types() {
+	// rlottie shares one pool of workers between every animation, it leaves a
+	// core to the main thread unless told otherwise. Only the size is set
+	// here, the workers start with the first render.
+	int render_threads = GLOBAL_DEF("rendering/lottie/render_threads", 0);
+	ProjectSettings::get_singleton()->set_custom_property_info("rendering/lottie/render_threads", PropertyInfo(Variant::INT, "rendering/lottie/render_threads", PROPERTY_HINT_RANGE, "0,64,1"));
+	if (render_threads <= 0) {
+		render_threads = MAX(OS::get_singleton()->get_processor_count() - 1, 1);
+	}
+	rlottie::configureThreadPool(render_threads);
+
 	Ref<ResourceImporterLottie> lottie_sprite_animation;
 	lottie_sprite_animation.instance();
 	ResourceFormatImporter::get_singleton()->add_importer(lottie_sprite_animation);
+
+	ClassDB::register_class<LottiePlayer>();
+	ClassDB::register_class<LottiePlayer3D>();
+	ClassDB::register_class<LottieDeltaTexture>();
+	ClassDB::register_class<LottieBatchConverter>();
 }
 
 void unregister_lottie_types() {
@@ -31,10 +31,26 @@
 #include "resource_importer_lottie.h"
 
 #include "core/bind/core_bind.h"
+#include "core/hash_map.h"
+#include "core/hashfuncs.h"
+#include "core/io/config_file.h"
 #include "core/io/file_access_pack.h"
+#include "core/io/resource_loader.h"
+#include "core/math/geometry.h"
+#include "core/os/dir_access.h"
+#include "core/os/os.h"
+#include "core/set.h"
 #include "scene/2d/animated_sprite.h"
+#include "scene/2d/mesh_instance_2d.h"
 #include "scene/2d/sprite.h"
 #include "scene/3d/sprite_3d.h"
+#include "scene/animation/animation_player.h"
+#include "scene/resources/material.h"
+#include "scene/resources/texture.h"
+
+#include "lottie_delta_texture.h"
+#include "lottie_image.h"
+#include "lottie_mesh.h"
 
 #include "thirdparty/rlottie/inc/rlottie.h"
 #include "thirdparty/rlottie/inc/rlottiecommon.h"
@@ -52,12 +68,46 @@ void ResourceImporterLottie::get_import_options(List<ImportOption> *r_options, i
 	}
 	r_options->push_back(ImportOption(PropertyInfo(Variant::INT, "start_frame", PROPERTY_HINT_RANGE, "0,65536,1,or_greater"), 0));
 	r_options->push_back(ImportOption(PropertyInfo(Variant::REAL, "skip_frames", PROPERTY_HINT_RANGE, "0,10,0.2,or_greater"), 0));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::REAL, "target_fps", PROPERTY_HINT_RANGE, "0,120,1,or_greater"), 0));
 	r_options->push_back(ImportOption(PropertyInfo(Variant::VECTOR2, "scale"), Vector2(1.0f, 1.0f)));
 	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "animation/import"), true));
 	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "animation/begin_playing"), true));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "animation/split_markers"), false));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::INT, "lod/levels", PROPERTY_HINT_RANGE, "1,8,1"), 1));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::INT, "render/threads", PROPERTY_HINT_RANGE, "0,64,1,or_greater"), 0));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "storage/deduplicate"), true));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "storage/trim"), false));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "storage/cache"), true));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "storage/streaming"), false));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::INT, "storage/mode", PROPERTY_HINT_ENUM, "Frames,Atlas,Texture Array,Delta,Mesh,Palette"), STORAGE_FRAMES));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::INT, "storage/keyframe_interval", PROPERTY_HINT_RANGE, "1,600,1"), 30));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::INT, "storage/atlas_max_size", PROPERTY_HINT_RANGE, "256,16384,1"), 2048));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "profile/report"), false));
 }
 
 bool ResourceImporterLottie::get_option_visibility(const String &p_option, const Map<StringName, Variant> &p_options) const {
+	if (p_option == "storage/atlas_max_size" && p_options.has("storage/mode")) {
+		return int(p_options["storage/mode"]) == STORAGE_ATLAS;
+	}
+	if (p_option == "storage/keyframe_interval" && p_options.has("storage/mode")) {
+		return int(p_options["storage/mode"]) == STORAGE_DELTA;
+	}
+	if (p_option == "skip_frames" && p_options.has("target_fps")) {
+		return float(p_options["target_fps"]) <= 0;
+	}
+	if (p_option == "animation/split_markers" && p_options.has("storage/mode")) {
+		int32_t storage_mode = p_options["storage/mode"];
+		return storage_mode == STORAGE_FRAMES || storage_mode == STORAGE_ATLAS || storage_mode == STORAGE_MESH || storage_mode == STORAGE_PALETTE;
+	}
+	// Rendered mipmaps need the whole frame in its own texture.
+	if (p_option == "lod/levels" && p_options.has("storage/mode") && p_options.has("storage/trim")) {
+		return int(p_options["storage/mode"]) == STORAGE_FRAMES && !bool(p_options["storage/trim"]);
+	}
+	// Atlas pages always hold trimmed frames, atlas pages and texture arrays
+	// are never cached and need every frame in memory.
+	if ((p_option == "storage/trim" || p_option == "storage/cache" || p_option == "storage/streaming") && p_options.has("storage/mode")) {
+		return int(p_options["storage/mode"]) == STORAGE_FRAMES;
+	}
 	return true;
 }
 
@@ -85,17 +135,764 @@ int ResourceImporterLottie::get_preset_count() const {
 	return 0;
 }
 
-Error ResourceImporterLottie::import(const String &p_source_file, const String &p_save_path, const Map<StringName, Variant> &p_options, List<String> *r_platform_variants, List<String> *r_gen_files, Variant *r_metadata) {
-	FileAccess *file = FileAccess::create(FileAccess::ACCESS_RESOURCES);
-	String data;
-	//Backport code
-	//String data = file->get_file_as_string(p_source_file, &err);
-	Vector<uint8_t> array = file->get_file_as_array(p_source_file);
-	data.parse_utf8((const char *)array.ptr(), array.size());
-	//End backport code
+static Size2i _get_mipmap_size(int32_t p_width, int32_t p_height, int32_t p_level) {
+	return Size2i(MAX(1, p_width >> p_level), MAX(1, p_height >> p_level));
+}
+
+// Samples the animation at exact times of p_target_fps, each sample takes the
+// source frame nearest to its time. rlottie evaluates whole frames only, the
+// timing stays exact because the sprite then plays at p_target_fps.
+static Vector<int32_t> _get_resampled_frames(size_t p_total_frames, double_t p_frame_rate, double_t p_target_fps) {
+	Vector<int32_t> lottie_frames;
+	int32_t sample_count = MAX(1, (int32_t)Math::round(p_total_frames * p_target_fps / p_frame_rate));
+	for (int32_t sample_i = 0; sample_i < sample_count; sample_i++) {
+		int32_t frame_lottie = (int32_t)Math::floor(sample_i * p_frame_rate / p_target_fps + 0.5);
+		lottie_frames.push_back(MIN(frame_lottie, (int32_t)p_total_frames - 1));
+	}
+	return lottie_frames;
+}
+
+static Vector<int32_t> _get_lottie_frames(size_t p_total_frames, double_t p_skip_frames, double_t p_frame_rate, double_t p_target_fps) {
+	if (p_target_fps > 0) {
+		return _get_resampled_frames(p_total_frames, p_frame_rate, p_target_fps);
+	}
+	Vector<int32_t> lottie_frames;
+	float unskipped = 0;
+	for (int32_t frame_lottie = 0; frame_lottie < (int32_t)p_total_frames; frame_lottie++) {
+		int skipped_frames = (int)floor(unskipped);
+		frame_lottie += skipped_frames;
+		unskipped -= skipped_frames;
+		lottie_frames.push_back(frame_lottie);
+		unskipped += p_skip_frames;
+	}
+	return lottie_frames;
+}
+
+// Collects the frames covered by the markers, each frame once and in order,
+// and for every marker the indices of its frames into that list. Markers that
+// cover the same frames then share their textures.
+static Vector<int32_t> _get_marker_frames(const rlottie::MarkerList &p_markers, size_t p_total_frames, double_t p_skip_frames, double_t p_frame_rate, double_t p_target_fps, Vector<String> &r_names, Vector<Vector<int32_t> > &r_marker_frames) {
+	Vector<Vector<int32_t> > marker_lottie_frames;
+	Set<int32_t> used_frames;
+	for (size_t marker_i = 0; marker_i < p_markers.size(); marker_i++) {
+		int32_t begin = std::get<1>(p_markers[marker_i]);
+		int32_t end = std::get<2>(p_markers[marker_i]);
+		if (begin < 0 || begin >= (int32_t)p_total_frames) {
+			continue;
+		}
+		int32_t count = CLAMP(end - begin, 1, (int32_t)p_total_frames - begin);
+		Vector<int32_t> lottie_frames = _get_lottie_frames(count, p_skip_frames, p_frame_rate, p_target_fps);
+		for (int32_t frame_i = 0; frame_i < lottie_frames.size(); frame_i++) {
+			lottie_frames.write[frame_i] += begin;
+			used_frames.insert(lottie_frames[frame_i]);
+		}
+		String name = String::utf8(std::get<0>(p_markers[marker_i]).c_str()).strip_edges();
+		if (name.empty()) {
+			name = "marker_" + itos(marker_i);
+		}
+		if (r_names.find(name) != -1) {
+			name += "_" + itos(marker_i);
+		}
+		r_names.push_back(name);
+		marker_lottie_frames.push_back(lottie_frames);
+	}
+
+	Vector<int32_t> frames;
+	Map<int32_t, int32_t> frame_indices;
+	for (Set<int32_t>::Element *E = used_frames.front(); E; E = E->next()) {
+		frame_indices.insert(E->get(), frames.size());
+		frames.push_back(E->get());
+	}
+	for (int32_t marker_i = 0; marker_i < marker_lottie_frames.size(); marker_i++) {
+		Vector<int32_t> indices;
+		for (int32_t frame_i = 0; frame_i < marker_lottie_frames[marker_i].size(); frame_i++) {
+			indices.push_back(frame_indices[marker_lottie_frames[marker_i][frame_i]]);
+		}
+		r_marker_frames.push_back(indices);
+	}
+	return frames;
+}
+
+// Adds the rect of p_pixels that changed since r_previous to the delta frames,
+// or the whole frame for keyframes and frames that changed for the most part,
+// then makes p_pixels the previous frame.
+static void _add_delta_frame(ResourceImporterLottie::RenderedFrames &r_frames, uint32_t *r_previous, const uint32_t *p_pixels, int32_t p_width, int32_t p_height, bool p_keyframe) {
+	Rect2 rect(0, 0, p_width, p_height);
+	bool keyframe = p_keyframe;
+	if (!keyframe) {
+		rect = lottie_get_dirty_rect(r_previous, p_pixels, p_width, p_height);
+		keyframe = rect.get_area() * 2 > p_width * p_height;
+		if (keyframe) {
+			rect = Rect2(0, 0, p_width, p_height);
+		}
+	}
+	PoolVector<uint8_t> data;
+	if (!rect.has_no_area()) {
+		int32_t rect_x = rect.position.x;
+		int32_t rect_y = rect.position.y;
+		int32_t rect_width = rect.size.width;
+		int32_t rect_height = rect.size.height;
+		PoolByteArray patch_data;
+		patch_data.resize(rect_width * rect_height * 4);
+		{
+			PoolByteArray::Write write = patch_data.write();
+			for (int32_t y = 0; y < rect_height; y++) {
+				memcpy(write.ptr() + y * rect_width * 4, p_pixels + (rect_y + y) * p_width + rect_x, rect_width * 4);
+			}
+		}
+		Ref<Image> patch;
+		patch.instance();
+		patch->create(rect_width, rect_height, false, Image::FORMAT_RGBA8, patch_data);
+		ERR_FAIL_COND(!Image::lossless_packer);
+		data = Image::lossless_packer(patch);
+		memcpy(r_previous, p_pixels, int64_t(p_width) * p_height * 4);
+	}
+	r_frames.delta_rects.push_back(rect);
+	r_frames.delta_data.push_back(data);
+	r_frames.delta_keyframes.push_back(keyframe);
+}
+
+// Byte offset of every mipmap level of a RGBA8 image in the layout Image
+// uses, followed by the size of the whole chain.
+static Vector<int64_t> _get_mipmap_offsets(int32_t p_width, int32_t p_height) {
+	Vector<int64_t> offsets;
+	int64_t offset = 0;
+	int32_t level = 0;
+	while (true) {
+		Size2i size = _get_mipmap_size(p_width, p_height, level);
+		offsets.push_back(offset);
+		offset += int64_t(size.width) * size.height * 4;
+		if (size.width == 1 && size.height == 1) {
+			break;
+		}
+		level++;
+	}
+	offsets.push_back(offset);
+	return offsets;
+}
+
+// Starts rendering p_frame into the first p_levels mipmaps of p_pixels, each
+// level on its own Animation starting at p_first_animation. The timings of a
+// level land in r_stats next to its render when profiling.
+static void _render_levels(std::vector<std::unique_ptr<rlottie::Animation> > &p_animations, std::vector<std::future<rlottie::Surface> > &r_renders, std::vector<rlottie::FrameStats> *r_stats, int32_t p_first_animation, int32_t p_levels, const Vector<int64_t> &p_offsets, uint8_t *p_pixels, int32_t p_width, int32_t p_height, int32_t p_frame) {
+	for (int32_t level = 0; level < p_levels; level++) {
+		int32_t animation_i = p_first_animation + level;
+		Size2i size = _get_mipmap_size(p_width, p_height, level);
+		rlottie::Surface surface((uint32_t *)(p_pixels + p_offsets[level]), size.width, size.height, size.width * 4);
+		rlottie::FrameStats *stats = r_stats ? &(*r_stats)[animation_i] : nullptr;
+		r_renders[animation_i] = p_animations[animation_i]->render(p_frame, surface, true, rlottie::RenderPriority::Background, stats);
+	}
+}
+
+// Levels past the rendered ones are a few pixels wide, those are filtered
+// down from the last rendered level instead.
+static void _filter_remaining_mipmaps(uint8_t *p_pixels, const Vector<int64_t> &p_offsets, int32_t p_width, int32_t p_height, int32_t p_rendered_levels) {
+	int32_t level_count = p_offsets.size() - 1;
+	if (p_rendered_levels >= level_count) {
+		return;
+	}
+	int32_t last_level = p_rendered_levels - 1;
+	int64_t last_level_size = p_offsets[p_rendered_levels] - p_offsets[last_level];
+	PoolByteArray last_level_data;
+	last_level_data.resize(last_level_size);
+	{
+		PoolByteArray::Write write = last_level_data.write();
+		memcpy(write.ptr(), p_pixels + p_offsets[last_level], last_level_size);
+	}
+	Size2i size = _get_mipmap_size(p_width, p_height, last_level);
+	Ref<Image> image;
+	image.instance();
+	image->create(size.width, size.height, false, Image::FORMAT_RGBA8, last_level_data);
+	image->generate_mipmaps();
+	PoolByteArray filtered = image->get_data();
+	PoolByteArray::Read read = filtered.read();
+	memcpy(p_pixels + p_offsets[p_rendered_levels], read.ptr() + last_level_size, p_offsets[level_count] - p_offsets[p_rendered_levels]);
+}
+
+// Returns the smallest rect holding every pixel with non-zero alpha. Fully
+// transparent frames keep a single pixel, a zero sized AtlasTexture region
+// would otherwise draw the whole atlas.
+static Rect2 _get_used_rect(const uint32_t *p_pixels, int32_t p_width, int32_t p_height) {
+	int32_t min_x = p_width;
+	int32_t min_y = p_height;
+	int32_t max_x = -1;
+	int32_t max_y = -1;
+	for (int32_t y = 0; y < p_height; y++) {
+		const uint32_t *row = p_pixels + y * p_width;
+		int32_t left = 0;
+		while (left < p_width && !(row[left] >> 24)) {
+			left++;
+		}
+		if (left == p_width) {
+			continue;
+		}
+		int32_t right = p_width - 1;
+		while (!(row[right] >> 24)) {
+			right--;
+		}
+		min_x = MIN(min_x, left);
+		max_x = MAX(max_x, right);
+		min_y = MIN(min_y, y);
+		max_y = y;
+	}
+	if (max_y < 0) {
+		return Rect2(0, 0, 1, 1);
+	}
+	return Rect2(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1);
+}
+
+static Ref<ImageTexture> _create_texture(const Ref<Image> &p_image, bool p_lossy, uint32_t p_flags) {
+	Ref<ImageTexture> tex;
+	tex.instance();
+	if (p_lossy) {
+		tex->set_storage(ImageTexture::STORAGE_COMPRESS_LOSSY);
+	} else {
+		tex->set_storage(ImageTexture::STORAGE_COMPRESS_LOSSLESS);
+	}
+	tex->create_from_image(p_image, p_flags);
+	return tex;
+}
+
+// Stores only the used region of a frame. The AtlasTexture wrapping it keeps
+// the full frame size and puts the region back at its offset through the
+// margin.
+static Ref<Texture> _create_trimmed_texture(const Ref<Image> &p_image, const Rect2 &p_used_rect, bool p_lossy) {
+	Ref<Image> used_image = p_image->get_rect(p_used_rect);
+	Ref<AtlasTexture> tex;
+	tex.instance();
+	tex->set_atlas(_create_texture(used_image, p_lossy, ImageTexture::FLAG_FILTER));
+	tex->set_region(Rect2(Point2(), p_used_rect.size));
+	tex->set_margin(Rect2(p_used_rect.position, p_image->get_size() - p_used_rect.size));
+	return tex;
+}
+
+// Packs the used region of every frame into as few pages of at most
+// p_max_size as possible. Every frame gets the index of its page and its
+// region on that page.
+static void _pack_atlas(const Vector<Ref<Image> > &p_images, const Vector<Rect2> &p_used_rects, int32_t p_max_size, Vector<Ref<Image> > &r_pages, Vector<int32_t> &r_page_indices, Vector<Rect2> &r_regions) {
+	const int32_t padding = 1;
+	int32_t frame_count = p_images.size();
+	r_page_indices.resize(frame_count);
+	r_regions.resize(frame_count);
+	int32_t page_start = 0;
+	while (page_start < frame_count) {
+		int64_t page_area = int64_t(p_max_size) * p_max_size;
+		int64_t area = 0;
+		int32_t page_end = page_start;
+		while (page_end < frame_count) {
+			Size2 size = p_used_rects[page_end].size + Size2(padding * 2, padding * 2);
+			int64_t frame_area = int64_t(size.width) * int64_t(size.height);
+			if (page_end > page_start && area + frame_area > page_area) {
+				break;
+			}
+			area += frame_area;
+			page_end++;
+		}
+
+		Vector<Point2i> positions;
+		Size2i page_size;
+		while (true) {
+			Vector<Size2i> sizes;
+			for (int32_t frame_i = page_start; frame_i < page_end; frame_i++) {
+				Size2 size = p_used_rects[frame_i].size;
+				sizes.push_back(Size2i(size.width + padding * 2, size.height + padding * 2));
+			}
+			Geometry::make_atlas(sizes, positions, page_size);
+			if ((page_size.width <= p_max_size && page_size.height <= p_max_size) || page_end - page_start == 1) {
+				break;
+			}
+			page_end = page_start + MAX(1, (page_end - page_start) * 3 / 4);
+		}
+
+		Ref<Image> page;
+		page.instance();
+		page->create(page_size.width, page_size.height, false, Image::FORMAT_RGBA8);
+		for (int32_t frame_i = page_start; frame_i < page_end; frame_i++) {
+			Point2 position = positions[frame_i - page_start] + Point2i(padding, padding);
+			page->blit_rect(p_images[frame_i], p_used_rects[frame_i], position);
+			r_page_indices.write[frame_i] = r_pages.size();
+			r_regions.write[frame_i] = Rect2(position, p_used_rects[frame_i].size);
+		}
+		r_pages.push_back(page);
+		page_start = page_end;
+	}
+}
+
+static Ref<Texture> _create_frame_texture(const Ref<Image> &p_image, const Rect2 &p_used_rect, bool p_trim, bool p_lossy) {
+	if (p_trim) {
+		return _create_trimmed_texture(p_image, p_used_rect, p_lossy);
+	}
+	if (p_image->has_mipmaps()) {
+		// The lossy and lossless storage modes only keep the base level, on
+		// load the rendered levels would be replaced by filtered ones.
+		Ref<ImageTexture> tex;
+		tex.instance();
+		tex->set_storage(ImageTexture::STORAGE_RAW);
+		tex->create_from_image(p_image, ImageTexture::FLAG_REPEAT | ImageTexture::FLAG_FILTER | ImageTexture::FLAG_MIPMAPS);
+		return tex;
+	}
+	return _create_texture(p_image, p_lossy, ImageTexture::FLAG_REPEAT | ImageTexture::FLAG_FILTER);
+}
+
+// Streamed frames are referenced by the scene through their path only. An
+// empty texture of the same type takes the place of the saved one, so the
+// frame data is released right away.
+static Ref<Texture> _create_placeholder_texture(const Ref<Texture> &p_texture, const String &p_path) {
+	Ref<Texture> placeholder = Object::cast_to<Texture>(ClassDB::instance(p_texture->get_class()));
+	ERR_FAIL_COND_V(placeholder.is_null(), p_texture);
+	placeholder->set_path(p_path, true);
+	return placeholder;
+}
+
+// Creates the directory streamed frames are saved to and removes the frames
+// of the previous import.
+static Error _prepare_stream_dir(const String &p_dir) {
+	DirAccess *dir = DirAccess::create_for_path(p_dir);
+	ERR_FAIL_COND_V(!dir, ERR_CANT_CREATE);
+	Error err = dir->make_dir_recursive(p_dir);
+	if (err == OK) {
+		err = dir->change_dir(p_dir);
+	}
+	if (err == OK) {
+		dir->list_dir_begin();
+		String file = dir->get_next();
+		while (file != String()) {
+			if (!dir->current_is_dir() && file.begins_with("frame_") && file.get_extension() == "res") {
+				dir->remove(file);
+			}
+			file = dir->get_next();
+		}
+		dir->list_dir_end();
+	}
+	memdelete(dir);
+	return err;
+}
+
+static PoolIntArray _get_file_sizes(const Vector<String> &p_paths) {
+	PoolIntArray sizes;
+	for (int32_t path_i = 0; path_i < p_paths.size(); path_i++) {
+		FileAccess *file = FileAccess::open(p_paths[path_i], FileAccess::READ);
+		sizes.push_back(file ? file->get_len() : 0);
+		if (file) {
+			memdelete(file);
+		}
+	}
+	return sizes;
+}
+
+// Rendered frame textures are kept in the import directory, keyed by the JSON
+// content and every option that changes their pixels or compression, so a
+// reimport only renders the frames it has not seen. Each entry holds an index
+// mapping lottie frames to texture slots, duplicate frames share a slot.
+#define LOTTIE_CACHE_DIR "res://.import/lottie_cache"
+#define LOTTIE_CACHE_VERSION 1
+// Entries kept per source file, enough to switch between a few branches
+// without rendering again.
+#define LOTTIE_CACHE_ENTRIES_PER_SOURCE 4
+
+static String _get_cache_key(const String &p_json_md5, const Vector2 &p_scale, bool p_lossy, bool p_trim, bool p_deduplicate, int32_t p_lod_levels) {
+	String key = itos(LOTTIE_CACHE_VERSION) + ":" + p_json_md5;
+	key += ":" + rtos(p_scale.x) + "x" + rtos(p_scale.y);
+	key += ":" + itos(p_lossy) + itos(p_trim) + itos(p_deduplicate);
+	key += ":" + itos(p_lod_levels);
+	return key.md5_text();
+}
+
+static String _get_cache_path(const String &p_name, const String &p_suffix) {
+	return String(LOTTIE_CACHE_DIR).plus_file(p_name + p_suffix);
+}
+
+static void _remove_cache_entry(const String &p_cache_key) {
+	String index_path = _get_cache_path(p_cache_key, ".index");
+	Ref<ConfigFile> index;
+	index.instance();
+	if (index->load(index_path) != OK) {
+		return;
+	}
+	int32_t slot_count = index->get_value("cache", "slot_count", 0);
+	DirAccess *dir = DirAccess::create(DirAccess::ACCESS_RESOURCES);
+	for (int32_t slot = 0; slot < slot_count; slot++) {
+		dir->remove(_get_cache_path(p_cache_key, "_" + itos(slot) + ".res"));
+	}
+	dir->remove(index_path);
+	memdelete(dir);
+}
+
+// Moves p_cache_key to the front of the entries used by p_source_file and
+// drops the least recently used ones.
+static void _touch_cache_entry(const String &p_source_file, const String &p_cache_key) {
+	String entries_path = _get_cache_path(p_source_file.md5_text(), ".entries");
+	Ref<ConfigFile> entries;
+	entries.instance();
+	entries->load(entries_path);
+	PoolStringArray keys = entries->get_value("cache", "entries", PoolStringArray());
+	PoolStringArray kept;
+	kept.push_back(p_cache_key);
+	for (int32_t key_i = 0; key_i < keys.size(); key_i++) {
+		if (keys[key_i] == p_cache_key) {
+			continue;
+		}
+		if (kept.size() < LOTTIE_CACHE_ENTRIES_PER_SOURCE) {
+			kept.push_back(keys[key_i]);
+		} else {
+			_remove_cache_entry(keys[key_i]);
+		}
+	}
+	entries->set_value("cache", "entries", kept);
+	entries->save(entries_path);
+}
+
+// Saves the textures created from p_render_frames, the ones after
+// p_cached_unique_count in p_unique_textures, as new slots of the entry.
+static void _store_cached_frames(const String &p_cache_key, const Ref<ConfigFile> &p_index, const Vector<Ref<Texture> > &p_unique_textures, int32_t p_cached_unique_count, const Vector<int32_t> &p_lottie_frames, const Vector<int32_t> &p_render_frames, const Vector<int32_t> &p_frame_unique_indices) {
+	DirAccess *dir = DirAccess::create(DirAccess::ACCESS_RESOURCES);
+	Error err = dir->make_dir_recursive(LOTTIE_CACHE_DIR);
+	memdelete(dir);
+	ERR_FAIL_COND(err != OK);
+	int32_t first_slot = p_index->get_value("cache", "slot_count", 0);
+	int32_t slot_count = first_slot;
+	Map<int32_t, int32_t> unique_slots;
+	for (int32_t unique_i = p_cached_unique_count; unique_i < p_unique_textures.size(); unique_i++) {
+		String slot_path = _get_cache_path(p_cache_key, "_" + itos(slot_count) + ".res");
+		if (ResourceSaver::save(slot_path, p_unique_textures[unique_i]) == OK) {
+			unique_slots.insert(unique_i, slot_count);
+		}
+		slot_count++;
+	}
+	for (int32_t render_i = 0; render_i < p_render_frames.size(); render_i++) {
+		int32_t frame_godot = p_render_frames[render_i];
+		Map<int32_t, int32_t>::Element *E = unique_slots.find(p_frame_unique_indices[frame_godot]);
+		if (E) {
+			p_index->set_value("frames", itos(p_lottie_frames[frame_godot]), E->get());
+		}
+	}
+	p_index->set_value("cache", "slot_count", slot_count);
+	ERR_FAIL_COND(p_index->save(_get_cache_path(p_cache_key, ".index")) != OK);
+}
+
+// Size the texture data takes once saved, found by running the packer the
+// resource saver uses on it.
+static int64_t _get_storage_size(const Ref<ImageTexture> &p_texture) {
+	Ref<Image> image = p_texture->get_data();
+	ERR_FAIL_COND_V(image.is_null(), 0);
+	PoolVector<uint8_t> data;
+	if (p_texture->get_storage() == ImageTexture::STORAGE_COMPRESS_LOSSY && Image::lossy_packer) {
+		data = Image::lossy_packer(image, p_texture->get_lossy_storage_quality());
+	} else if (Image::lossless_packer) {
+		data = Image::lossless_packer(image);
+	}
+	return data.size();
+}
+
+static PoolIntArray _get_texture_sizes(const Vector<Ref<Texture> > &p_textures) {
+	PoolIntArray sizes;
+	Set<Ref<Texture> > measured;
+	for (int32_t texture_i = 0; texture_i < p_textures.size(); texture_i++) {
+		Ref<Texture> texture = p_textures[texture_i];
+		Ref<AtlasTexture> atlas_texture = texture;
+		if (atlas_texture.is_valid()) {
+			texture = atlas_texture->get_atlas();
+		}
+		Ref<ImageTexture> image_texture = texture;
+		if (image_texture.is_null() || measured.has(texture)) {
+			continue;
+		}
+		measured.insert(texture);
+		sizes.push_back(_get_storage_size(image_texture));
+	}
+	return sizes;
+}
+
+// Plays the layers of a texture array on a quad. The shader picks the layer
+// from TIME, so hundreds of instances animate with one texture bound and no
+// work on the CPU. The frame parameter is the frame shown when not playing,
+// and the offset of the animation when playing.
+static MeshInstance *_create_texture_array_sprite(const Ref<TextureArray> &p_frames, float p_fps, int32_t p_start_frame, bool p_playing) {
+	String code;
+	code += "shader_type spatial;\n";
+	code += "render_mode cull_disabled, depth_draw_alpha_prepass;\n\n";
+	code += "uniform sampler2DArray frames : hint_albedo;\n";
+	code += "uniform float frame_count = 1.0;\n";
+	code += "uniform float fps = 30.0;\n";
+	code += "uniform float frame = 0.0;\n";
+	code += "uniform bool playing = true;\n";
+	code += "uniform bool billboard = false;\n\n";
+	code += "void vertex() {\n";
+	code += "\tif (billboard) {\n";
+	code += "\t\tMODELVIEW_MATRIX = INV_CAMERA_MATRIX * mat4(CAMERA_MATRIX[0], CAMERA_MATRIX[1], CAMERA_MATRIX[2], WORLD_MATRIX[3]);\n";
+	code += "\t}\n";
+	code += "}\n\n";
+	code += "void fragment() {\n";
+	code += "\tfloat layer = frame;\n";
+	code += "\tif (playing) {\n";
+	code += "\t\tlayer = mod(floor(frame + TIME * fps), frame_count);\n";
+	code += "\t}\n";
+	code += "\tvec4 color = texture(frames, vec3(UV, layer));\n";
+	code += "\tALBEDO = color.rgb;\n";
+	code += "\tALPHA = color.a;\n";
+	code += "}\n";
+	Ref<Shader> shader;
+	shader.instance();
+	shader->set_code(code);
+	Ref<ShaderMaterial> material;
+	material.instance();
+	material->set_shader(shader);
+	material->set_shader_param("frames", p_frames);
+	material->set_shader_param("frame_count", p_frames->get_depth());
+	material->set_shader_param("fps", p_fps);
+	material->set_shader_param("frame", p_start_frame);
+	material->set_shader_param("playing", p_playing);
+	// Same size as a Sprite3D showing the frame with the default pixel size.
+	Ref<QuadMesh> quad;
+	quad.instance();
+	quad->set_size(Size2(p_frames->get_width(), p_frames->get_height()) * 0.01);
+	quad->set_material(material);
+	MeshInstance *mesh_instance = memnew(MeshInstance);
+	mesh_instance->set_mesh(quad);
+	return mesh_instance;
+}
+
+#define LOTTIE_PALETTE_SIZE 256
+
+static _FORCE_INLINE_ uint32_t _premultiply_channel(uint32_t p_channel, uint32_t p_alpha) {
+	return (p_channel * p_alpha + 127) / 255;
+}
+
+// An entry can stand for a pixel when it blends to the premultiplied color
+// rlottie rendered, so low alpha edges reuse the color of their shape.
+static int32_t _find_palette_entry(const Vector<uint32_t> &p_palette, uint32_t p_pixel, bool p_coverage) {
+	uint32_t alpha = p_pixel >> 24;
+	for (int32_t entry_i = 0; entry_i < p_palette.size(); entry_i++) {
+		uint32_t entry = p_palette[entry_i];
+		if (!p_coverage && entry >> 24 != alpha) {
+			continue;
+		}
+		bool same = true;
+		for (int32_t shift = 0; shift < 24 && same; shift += 8) {
+			same = _premultiply_channel((entry >> shift) & 0xff, alpha) == _premultiply_channel((p_pixel >> shift) & 0xff, alpha);
+		}
+		if (same) {
+			return entry_i;
+		}
+	}
+	return -1;
+}
+
+// Maps the pixels of every frame to one shared palette of at most
+// LOTTIE_PALETTE_SIZE colors. Frames become L8 palette indices, or with
+// p_coverage LA8 indices of opaque colors with the alpha of the pixel, which
+// fits anti aliased artwork. Returns false when the palette overflows.
+static bool _build_palette(const Vector<Ref<Image> > &p_images, bool p_coverage, Vector<uint32_t> &r_palette, Vector<Ref<Image> > &r_indexed_images) {
+	r_palette.clear();
+	r_indexed_images.clear();
+	HashMap<uint32_t, int32_t> pixel_entries;
+	int32_t channels = p_coverage ? 2 : 1;
+	for (int32_t image_i = 0; image_i < p_images.size(); image_i++) {
+		const Ref<Image> &image = p_images[image_i];
+		int64_t pixel_count = image->get_width() * image->get_height();
+		PoolByteArray pixels = image->get_data();
+		PoolByteArray::Read pixels_read = pixels.read();
+		const uint32_t *pixels_ptr = (const uint32_t *)pixels_read.ptr();
+		PoolByteArray indexed;
+		indexed.resize(pixel_count * channels);
+		PoolByteArray::Write indexed_write = indexed.write();
+		for (int64_t pixel_i = 0; pixel_i < pixel_count; pixel_i++) {
+			uint32_t pixel = pixels_ptr[pixel_i];
+			uint32_t alpha = pixel >> 24;
+			int32_t entry = 0;
+			if (alpha || !p_coverage) {
+				const int32_t *known_entry = pixel_entries.getptr(pixel);
+				if (known_entry) {
+					entry = *known_entry;
+				} else {
+					entry = _find_palette_entry(r_palette, pixel, p_coverage);
+					if (entry == -1) {
+						if (r_palette.size() == LOTTIE_PALETTE_SIZE) {
+							return false;
+						}
+						entry = r_palette.size();
+						r_palette.push_back(p_coverage ? pixel | 0xff000000 : pixel);
+					}
+					pixel_entries.set(pixel, entry);
+				}
+			}
+			indexed_write[pixel_i * channels] = entry;
+			if (p_coverage) {
+				indexed_write[pixel_i * channels + 1] = alpha;
+			}
+		}
+		indexed_write.release();
+		Ref<Image> indexed_image;
+		indexed_image.instance();
+		indexed_image->create(image->get_width(), image->get_height(), false, p_coverage ? Image::FORMAT_LA8 : Image::FORMAT_L8, indexed);
+		r_indexed_images.push_back(indexed_image);
+	}
+	return true;
+}
+
+// Expands palette indexed frames, the frame textures are not filtered so
+// neighbouring indices never blend.
+static Ref<ShaderMaterial> _create_palette_material(const Vector<uint32_t> &p_palette) {
+	PoolByteArray palette_data;
+	palette_data.resize(LOTTIE_PALETTE_SIZE * 4);
+	PoolByteArray::Write palette_write = palette_data.write();
+	memset(palette_write.ptr(), 0, LOTTIE_PALETTE_SIZE * 4);
+	memcpy(palette_write.ptr(), p_palette.ptr(), p_palette.size() * 4);
+	palette_write.release();
+	Ref<Image> palette_image;
+	palette_image.instance();
+	palette_image->create(LOTTIE_PALETTE_SIZE, 1, false, Image::FORMAT_RGBA8, palette_data);
+
+	String code;
+	code += "shader_type canvas_item;\n\n";
+	code += "uniform sampler2D palette;\n\n";
+	code += "void fragment() {\n";
+	code += "\tvec4 indexed = texture(TEXTURE, UV);\n";
+	code += "\tfloat entry = floor(indexed.r * 255.0 + 0.5);\n";
+	code += "\tvec4 color = texture(palette, vec2((entry + 0.5) / " + itos(LOTTIE_PALETTE_SIZE) + ".0, 0.5));\n";
+	code += "\tCOLOR = vec4(color.rgb, color.a * indexed.a) * COLOR;\n";
+	code += "}\n";
+	Ref<Shader> shader;
+	shader.instance();
+	shader->set_code(code);
+	Ref<ShaderMaterial> material;
+	material.instance();
+	material->set_shader(shader);
+	material->set_shader_param("palette", _create_texture(palette_image, false, 0));
+	return material;
+}
+
+// Reads the file with a null after its content, as the in place parser needs.
+static Error _read_json(const String &p_path, Vector<uint8_t> &r_json) {
+	Error err = OK;
+	FileAccess *file = FileAccess::open(p_path, FileAccess::READ, &err);
+	ERR_FAIL_COND_V(!file, err);
+	int64_t length = file->get_len();
+	r_json.resize(length + 1);
+	int64_t read = file->get_buffer(r_json.ptrw(), length);
+	memdelete(file);
+	ERR_FAIL_COND_V(read != length, ERR_FILE_CORRUPT);
+	r_json.write[length] = 0;
+	return OK;
+}
+
+// Converts every sampled frame to mesh arrays, frames with identical arrays
+// share one entry of r_unique_arrays.
+static void _get_mesh_frames(rlottie::Animation *p_lottie, size_t p_width, size_t p_height, const Vector<int32_t> &p_lottie_frames, bool p_3d, Vector<Array> &r_unique_arrays, Vector<int32_t> &r_frame_unique_indices) {
+	Map<uint32_t, int32_t> unique_hashes;
+	bool unsupported = false;
+	for (int32_t frame_i = 0; frame_i < p_lottie_frames.size(); frame_i++) {
+		const LOTLayerNode *tree = p_lottie->renderTree(p_lottie_frames[frame_i], p_width, p_height);
+		bool frame_unsupported = false;
+		Array arrays = lottie_get_mesh_arrays(tree, Size2(p_width, p_height), p_3d, &frame_unsupported);
+		unsupported = unsupported || frame_unsupported;
+		uint32_t arrays_hash = arrays.hash();
+		Map<uint32_t, int32_t>::Element *E = unique_hashes.find(arrays_hash);
+		if (E && Variant(r_unique_arrays[E->get()]) == Variant(arrays)) {
+			r_frame_unique_indices.push_back(E->get());
+			continue;
+		}
+		if (!E) {
+			unique_hashes.insert(arrays_hash, r_unique_arrays.size());
+		}
+		r_frame_unique_indices.push_back(r_unique_arrays.size());
+		r_unique_arrays.push_back(arrays);
+	}
+	if (unsupported) {
+		WARN_PRINT("Lottie masks, mattes and image layers are not converted to meshes, use a texture storage mode for them.");
+	}
+}
+
+// Builds a mesh of every unique frame. The AnimationPlayer swaps the mesh
+// every frame, with one animation per entry of p_animation_names.
+static Node *_create_mesh_scene(const Vector<Array> &p_unique_arrays, const Vector<int32_t> &p_frame_unique_indices, const Vector<String> &p_animation_names, const Vector<Vector<int32_t> > &p_animation_frames, float p_fps, bool p_3d, bool p_animate, bool p_playing, int32_t p_start_frame) {
+	Vector<Ref<ArrayMesh> > unique_meshes;
+	for (int32_t unique_i = 0; unique_i < p_unique_arrays.size(); unique_i++) {
+		Ref<ArrayMesh> mesh;
+		mesh.instance();
+		if (!p_unique_arrays[unique_i].empty()) {
+			mesh->add_surface_from_arrays(Mesh::PRIMITIVE_TRIANGLES, p_unique_arrays[unique_i]);
+		}
+		unique_meshes.push_back(mesh);
+	}
+	Vector<Ref<ArrayMesh> > meshes;
+	for (int32_t frame_i = 0; frame_i < p_frame_unique_indices.size(); frame_i++) {
+		meshes.push_back(unique_meshes[p_frame_unique_indices[frame_i]]);
+	}
+
+	Node *root = nullptr;
+	if (p_3d) {
+		Ref<SpatialMaterial> material;
+		material.instance();
+		material->set_flag(SpatialMaterial::FLAG_ALBEDO_FROM_VERTEX_COLOR, true);
+		material->set_flag(SpatialMaterial::FLAG_SRGB_VERTEX_COLOR, true);
+		material->set_feature(SpatialMaterial::FEATURE_TRANSPARENT, true);
+		material->set_cull_mode(SpatialMaterial::CULL_DISABLED);
+		MeshInstance *mesh_instance = memnew(MeshInstance);
+		mesh_instance->set_material_override(material);
+		root = mesh_instance;
+	} else {
+		root = memnew(MeshInstance2D);
+	}
+	const Vector<int32_t> &first_frames = p_animation_frames[0];
+	root->set("mesh", meshes[first_frames[CLAMP(p_start_frame, 0, first_frames.size() - 1)]]);
+	if (!p_animate) {
+		return root;
+	}
+
+	AnimationPlayer *player = memnew(AnimationPlayer);
+	player->set_name("AnimationPlayer");
+	root->add_child(player);
+	player->set_owner(root);
+	for (int32_t animation_i = 0; animation_i < p_animation_names.size(); animation_i++) {
+		const Vector<int32_t> &animation_frames = p_animation_frames[animation_i];
+		Ref<Animation> animation;
+		animation.instance();
+		animation->set_length(animation_frames.size() / p_fps);
+		animation->set_step(1.0 / p_fps);
+		animation->set_loop(true);
+		int32_t track = animation->add_track(Animation::TYPE_VALUE);
+		animation->track_set_path(track, NodePath(".:mesh"));
+		animation->value_track_set_update_mode(track, Animation::UPDATE_DISCRETE);
+		for (int32_t frame_i = 0; frame_i < animation_frames.size(); frame_i++) {
+			animation->track_insert_key(track, frame_i / p_fps, meshes[animation_frames[frame_i]]);
+		}
+		player->add_animation(p_animation_names[animation_i], animation);
+	}
+	if (p_playing) {
+		player->set_autoplay(p_animation_names[0]);
+	}
+	return root;
+}
+
+// Streamed frames are referenced by the scene through the placeholder only,
+// the frame texture is released once it is saved.
+void ResourceImporterLottie::save_streamed_frame(StreamedFrame &r_frame) {
+	Ref<Texture> tex = _create_frame_texture(r_frame.image, r_frame.used_rect, r_frame.trim, r_frame.lossy);
+	if (ResourceSaver::save(r_frame.path, tex) == OK) {
+		r_frame.texture = _create_placeholder_texture(tex, r_frame.path);
+	}
+}
+
+Error ResourceImporterLottie::render_frames(const String &p_source_file, const String &p_save_path, const Map<StringName, Variant> &p_options, RenderedFrames &r_frames, StreamFunc p_stream_func, void *p_stream_userdata) {
+	// The JSON is parsed in place from the file buffer, it is never decoded
+	// into a String or copied into a std::string.
+	Vector<uint8_t> json;
+	Error err = _read_json(p_source_file, json);
+	ERR_FAIL_COND_V(err != OK, err);
+	// Key the model cache on the content as well, so a changed file is never
+	// served stale.
+	String json_md5 = FileAccess::get_md5(p_source_file);
+	std::string key = (p_source_file + ":" + json_md5).utf8().get_data();
+	// The profile report times every stage of the import, parse time is zero
+	// when the model was still in the rlottie cache.
+	bool profile = p_options["profile/report"];
+	uint64_t parse_begin = OS::get_singleton()->get_ticks_usec();
 	std::unique_ptr<rlottie::Animation> lottie =
-			rlottie::Animation::loadFromData(data.utf8().ptrw(), p_source_file.utf8().ptr());
+			rlottie::Animation::loadFromBuffer((char *)json.ptrw(), key);
 	ERR_FAIL_COND_V(!lottie, FAILED);
+	json.clear();
+	uint64_t parse_usec = OS::get_singleton()->get_ticks_usec() - parse_begin;
 	size_t width = 0;
 	size_t height = 0;
 	lottie->size(width, height);
@@ -106,97 +903,544 @@ Error ResourceImporterLottie::import(const String &p_source_file, const String &
 	height *= scale.height;
 	ERR_FAIL_COND_V(!width, FAILED);
 	ERR_FAIL_COND_V(!height, FAILED);
-	Ref<SpriteFrames> frames;
-	frames.instance();
-	List<StringName> animations;
-	frames->get_animation_list(&animations);
-	String name = animations[0];
+	r_frames.width = width;
+	r_frames.height = height;
 	double_t skip_frames = p_options["skip_frames"];
-	frames->set_animation_speed(name, lottie->frameRate() / (1.0 + skip_frames));
-	Vector<Ref<ImageTexture> > image_textures;
+	// Whole frames can not be sampled above the source rate.
+	double_t target_fps = MIN(double_t(p_options["target_fps"]), lottie->frameRate());
+	r_frames.animation_speed = target_fps > 0 ? target_fps : lottie->frameRate() / (1.0 + skip_frames);
+	rlottie::ModelStats model_stats = lottie->modelStats();
+
+	bool lossy = p_options["compress/lossy"];
+	bool deduplicate = p_options["storage/deduplicate"];
+	int32_t storage_mode = p_options["storage/mode"];
+	if (storage_mode == STORAGE_TEXTURE_ARRAY && !(p_options["3d"] && p_options["animation/import"])) {
+		WARN_PRINT("Texture array storage needs the 3d and animation/import options, storing frames instead.");
+		storage_mode = STORAGE_FRAMES;
+	}
+	if (storage_mode == STORAGE_PALETTE && p_options["3d"]) {
+		WARN_PRINT("Palette storage is expanded by a canvas item shader and needs 2d sprites, storing frames instead.");
+		storage_mode = STORAGE_FRAMES;
+	}
+	r_frames.storage_mode = storage_mode;
+	r_frames.lossy = lossy;
+	// Marker animations replace the default one and only the frames inside a
+	// marker are rendered. Texture arrays and delta frames play back a single
+	// sequence, so they keep every frame.
+	if (bool(p_options["animation/split_markers"]) && (storage_mode == STORAGE_FRAMES || storage_mode == STORAGE_ATLAS || storage_mode == STORAGE_MESH || storage_mode == STORAGE_PALETTE)) {
+		r_frames.lottie_frames = _get_marker_frames(lottie->markers(), lottie->totalFrame(), skip_frames, lottie->frameRate(), target_fps, r_frames.marker_names, r_frames.marker_frames);
+	}
+	if (r_frames.marker_names.empty()) {
+		r_frames.lottie_frames = _get_lottie_frames(lottie->totalFrame(), skip_frames, lottie->frameRate(), target_fps);
+	}
+	const Vector<int32_t> &lottie_frames = r_frames.lottie_frames;
+	int32_t godot_frame_count = lottie_frames.size();
+	ERR_FAIL_COND_V(!godot_frame_count, FAILED);
+
+	// Meshes are drawn from the flattened render tree instead of rendered
+	// frames, they stay sharp at any scale and grow with the geometry only.
+	if (storage_mode == STORAGE_MESH) {
+		_get_mesh_frames(lottie.get(), width, height, lottie_frames, p_options["3d"], r_frames.mesh_arrays, r_frames.frame_unique_indices);
+		return OK;
+	}
+	bool trim = storage_mode == STORAGE_ATLAS || (storage_mode == STORAGE_FRAMES && bool(p_options["storage/trim"]));
+	r_frames.trim = trim;
+	// Atlas pages depend on every frame of the import, only per frame
+	// textures can be reused from the frame cache.
+	// Streaming saves every frame to its own file as soon as it is rendered
+	// and keeps only the last unique frame in memory.
+	bool streaming = bool(p_options["storage/streaming"]) && storage_mode == STORAGE_FRAMES;
+	bool use_cache = bool(p_options["storage/cache"]) && storage_mode == STORAGE_FRAMES && !streaming;
+	r_frames.streaming = streaming;
+	r_frames.use_cache = use_cache;
+	// Generated frames live next to the imported scene, under .import for
+	// editor imports, so they stay out of the project tree and its scans.
+	String stream_dir = p_save_path + ".frames";
+	if (streaming) {
+		err = _prepare_stream_dir(stream_dir);
+		ERR_FAIL_COND_V(err != OK, err);
+	}
+	Error stream_err = OK;
+	// Every LOD level is a mipmap of the frame, rendered from the same model
+	// at its own size, so small instances sample a sharp frame instead of a
+	// filtered down one.
+	Vector<int64_t> mipmap_offsets = _get_mipmap_offsets(width, height);
+	int32_t lod_levels = 1;
+	if (storage_mode == STORAGE_FRAMES && !trim) {
+		lod_levels = CLAMP(int32_t(p_options["lod/levels"]), 1, mipmap_offsets.size() - 1);
+	}
+	bool mipmaps = lod_levels > 1;
+	r_frames.cache_index.instance();
+	if (use_cache) {
+		r_frames.cache_key = _get_cache_key(json_md5, scale, lossy, trim, deduplicate, lod_levels);
+		r_frames.cache_index->load(_get_cache_path(r_frames.cache_key, ".index"));
+	}
 
-	int godot_frame_count = (int) (lottie->totalFrame() / (1.0 + skip_frames)) + 1;
-	image_textures.resize(godot_frame_count);
+	// Cached frames are only looked up here, their textures are loaded with
+	// the scene.
+	Vector<int32_t> &frame_unique_indices = r_frames.frame_unique_indices;
+	frame_unique_indices.resize(godot_frame_count);
+	Map<int32_t, int32_t> slot_unique_indices;
+	Vector<int32_t> &uncached_frames = r_frames.uncached_frames;
 	for (int32_t frame_godot = 0; frame_godot < godot_frame_count; frame_godot++) {
-		Ref<ImageTexture> tex;
-		tex.instance();
-		if (p_options["compress/lossy"]) {
-			tex->set_storage(ImageTexture::STORAGE_COMPRESS_LOSSY);
+		int32_t unique_i = -1;
+		String frame_key = itos(lottie_frames[frame_godot]);
+		if (use_cache && r_frames.cache_index->has_section_key("frames", frame_key)) {
+			int32_t slot = r_frames.cache_index->get_value("frames", frame_key);
+			Map<int32_t, int32_t>::Element *E = slot_unique_indices.find(slot);
+			if (E) {
+				unique_i = E->get();
+			} else if (FileAccess::exists(_get_cache_path(r_frames.cache_key, "_" + itos(slot) + ".res"))) {
+				unique_i = r_frames.cached_slots.size();
+				r_frames.cached_slots.push_back(slot);
+				slot_unique_indices.insert(slot, unique_i);
+			}
+		}
+		frame_unique_indices.write[frame_godot] = unique_i;
+		if (unique_i == -1) {
+			uncached_frames.push_back(frame_godot);
+		}
+	}
+	int32_t cached_unique_count = r_frames.cached_slots.size();
+	int32_t render_count = uncached_frames.size();
+
+	// Each worker owns an Animation, and with it a renderer, so frames render
+	// concurrently on the rlottie scheduler instead of one after another.
+	int32_t thread_count = p_options["render/threads"];
+	if (thread_count <= 0) {
+		thread_count = OS::get_singleton()->get_processor_count();
+	}
+	int32_t worker_count = CLAMP(thread_count, 1, MAX(render_count, 1));
+	// A worker keeps one Animation per LOD level, each renderer then always
+	// renders at the same size. They all share the parsed model.
+	int32_t animation_count = worker_count * lod_levels;
+	std::vector<std::unique_ptr<rlottie::Animation> > animations;
+	animations.push_back(std::move(lottie));
+	for (int32_t animation_i = 1; animation_i < animation_count; animation_i++) {
+		animations.push_back(animations[0]->clone());
+	}
+	// Each render writes its timings next to it, so they always belong to
+	// the frame that render drew.
+	std::vector<rlottie::FrameStats> render_stats(profile ? animation_count : 0);
+	std::vector<rlottie::FrameStats> *render_stats_ptr = profile ? &render_stats : nullptr;
+	uint64_t render_begin = OS::get_singleton()->get_ticks_usec();
+
+	// Delta frames are encoded against the frame rendered before them, only
+	// that one is kept.
+	Vector<uint32_t> previous_frame;
+	int32_t keyframe_interval = MAX(int32_t(p_options["storage/keyframe_interval"]), 1);
+	if (storage_mode == STORAGE_DELTA) {
+		previous_frame.resize(width * height);
+	}
+
+	// Frames render straight into the pixel data of the Image that keeps them.
+	// A buffer is only replaced once an Image took it, duplicates and dropped
+	// frames render the next frame into the same memory.
+	int64_t pixel_count = mipmap_offsets[lod_levels] / sizeof(uint32_t);
+	int64_t buffer_byte_size = mipmaps ? mipmap_offsets[mipmap_offsets.size() - 1] : mipmap_offsets[1];
+	Vector<PoolByteArray> buffers;
+	buffers.resize(worker_count);
+	std::vector<PoolByteArray::Write> buffer_writes(worker_count);
+	std::vector<std::future<rlottie::Surface> > renders(animation_count);
+	for (int32_t worker_i = 0; worker_i < MIN(worker_count, render_count); worker_i++) {
+		PoolByteArray &buffer = buffers.write[worker_i];
+		buffer.resize(buffer_byte_size);
+		buffer_writes[worker_i] = buffer.write();
+		_render_levels(animations, renders, render_stats_ptr, worker_i * lod_levels, lod_levels, mipmap_offsets, buffer_writes[worker_i].ptr(), width, height, lottie_frames[uncached_frames[worker_i]]);
+	}
+
+	// Frames holding a pose render to the same pixels, those share the texture
+	// of the first such frame. Candidates are found by hash and confirmed byte
+	// for byte, so a collision never merges two different frames.
+	Map<uint32_t, int32_t> unique_frame_hashes;
+	Vector<Ref<Image> > &unique_images = r_frames.unique_images;
+	Vector<Rect2> &unique_used_rects = r_frames.unique_used_rects;
+	PoolRealArray frame_update_msec;
+	PoolRealArray frame_rasterize_msec;
+	PoolRealArray frame_blend_msec;
+	for (int32_t render_i = 0; render_i < render_count; render_i++) {
+		int32_t worker_i = render_i % worker_count;
+		rlottie::FrameStats frame_stats;
+		for (int32_t level = 0; level < lod_levels; level++) {
+			int32_t animation_i = worker_i * lod_levels + level;
+			renders[animation_i].get();
+			if (profile) {
+				const rlottie::FrameStats &stats = render_stats[animation_i];
+				frame_stats.update += stats.update;
+				frame_stats.rasterize += stats.rasterize;
+				frame_stats.blend += stats.blend;
+			}
+		}
+		if (profile) {
+			frame_update_msec.push_back(frame_stats.update);
+			frame_rasterize_msec.push_back(frame_stats.rasterize);
+			frame_blend_msec.push_back(frame_stats.blend);
+		}
+		uint32_t *frame_pixels = (uint32_t *)buffer_writes[worker_i].ptr();
+		lottie_convert_to_rgba8(frame_pixels, pixel_count);
+		if (mipmaps) {
+			_filter_remaining_mipmaps(buffer_writes[worker_i].ptr(), mipmap_offsets, width, height, lod_levels);
+		}
+
+		if (storage_mode == STORAGE_DELTA) {
+			_add_delta_frame(r_frames, previous_frame.ptrw(), frame_pixels, width, height, render_i % keyframe_interval == 0);
+		} else {
+			int32_t unique_i = -1;
+			uint32_t pixels_hash = 0;
+			if (deduplicate) {
+				pixels_hash = hash_djb2_buffer((const uint8_t *)frame_pixels, buffer_byte_size);
+				Map<uint32_t, int32_t>::Element *E = unique_frame_hashes.find(pixels_hash);
+				if (E) {
+					PoolByteArray unique_pixels = unique_images[E->get()]->get_data();
+					PoolByteArray::Read unique_read = unique_pixels.read();
+					if (!memcmp(unique_read.ptr(), frame_pixels, buffer_byte_size)) {
+						unique_i = E->get();
+					}
+				}
+			}
+			if (unique_i == -1) {
+				unique_i = unique_images.size();
+				if (streaming && unique_i > 0) {
+					// A pose is still shared with the unique frame right before it.
+					unique_frame_hashes.clear();
+					unique_images.write[unique_i - 1].unref();
+				}
+				if (deduplicate && !unique_frame_hashes.has(pixels_hash)) {
+					unique_frame_hashes.insert(pixels_hash, unique_i);
+				}
+				if (trim) {
+					unique_used_rects.push_back(_get_used_rect(frame_pixels, width, height));
+				}
+				buffer_writes[worker_i].release();
+				Ref<Image> img;
+				img.instance();
+				img->create((int)width, (int)height, mipmaps, Image::FORMAT_RGBA8, buffers[worker_i]);
+				unique_images.push_back(img);
+				buffers.write[worker_i] = PoolByteArray();
+				if (streaming) {
+					// Returning early would free the buffers still being rendered
+					// into, errors are reported once every render finished.
+					StreamedFrame streamed;
+					streamed.image = img;
+					streamed.used_rect = trim ? unique_used_rects[unique_i] : Rect2();
+					streamed.trim = trim;
+					streamed.lossy = lossy;
+					streamed.path = stream_dir.plus_file("frame_" + itos(unique_i).pad_zeros(5) + ".res");
+					if (p_stream_func) {
+						p_stream_func(p_stream_userdata, streamed);
+					} else {
+						save_streamed_frame(streamed);
+					}
+					if (streamed.texture.is_valid()) {
+						r_frames.stream_paths.push_back(streamed.path);
+					} else {
+						stream_err = ERR_CANT_CREATE;
+					}
+					r_frames.stream_textures.push_back(streamed.texture);
+				}
+			}
+			frame_unique_indices.write[uncached_frames[render_i]] = cached_unique_count + unique_i;
+		}
+
+		int32_t next_render = render_i + worker_count;
+		if (next_render < render_count) {
+			PoolByteArray &buffer = buffers.write[worker_i];
+			if (buffer.size() != buffer_byte_size) {
+				buffer.resize(buffer_byte_size);
+				buffer_writes[worker_i] = buffer.write();
+			}
+			_render_levels(animations, renders, render_stats_ptr, worker_i * lod_levels, lod_levels, mipmap_offsets, buffer_writes[worker_i].ptr(), width, height, lottie_frames[uncached_frames[next_render]]);
 		} else {
-			tex->set_storage(ImageTexture::STORAGE_COMPRESS_LOSSLESS);
+			buffer_writes[worker_i].release();
 		}
-		image_textures.write[frame_godot] = tex;
 	}
+	uint64_t render_usec = OS::get_singleton()->get_ticks_usec() - render_begin;
+	int64_t image_bytes = (streaming ? MIN(unique_images.size(), 1) : unique_images.size()) * buffer_byte_size;
+	ERR_FAIL_COND_V(stream_err != OK, stream_err);
 
-	float unskipped = 0;
-	size_t frame_godot = 0;
-	for (int32_t frame_lottie = 0; frame_lottie < lottie->totalFrame(); frame_lottie++) {
-		int skipped_frames = (int)floor(unskipped);
-		frame_lottie += skipped_frames;
-		unskipped -= skipped_frames;
+	// Pages and palette indices are packed here, so only creating their
+	// textures is left to the builders.
+	if (storage_mode == STORAGE_ATLAS) {
+		int32_t atlas_max_size = p_options["storage/atlas_max_size"];
+		_pack_atlas(unique_images, unique_used_rects, atlas_max_size, r_frames.atlas_pages, r_frames.atlas_page_indices, r_frames.atlas_regions);
+		unique_images.clear();
+	} else if (storage_mode == STORAGE_PALETTE) {
+		// Full color entries need a byte per pixel, anti aliased artwork
+		// usually only fits with the alpha kept per pixel.
+		Vector<Ref<Image> > indexed_images;
+		if (_build_palette(unique_images, false, r_frames.palette, indexed_images) || _build_palette(unique_images, true, r_frames.palette, indexed_images)) {
+			unique_images = indexed_images;
+		} else {
+			WARN_PRINT("The frames use more colors than a palette holds, storing frames instead.");
+			r_frames.storage_mode = STORAGE_FRAMES;
+			r_frames.palette.clear();
+		}
+	}
 
-		Vector<uint32_t> buffer;
-		buffer.resize(width * height);
-		rlottie::Surface surface(buffer.ptrw(), width, height, width * 4);
-		lottie->renderSync(frame_lottie, surface);
-		PoolByteArray pixels;
-		int32_t buffer_byte_size = buffer.size() * sizeof(uint32_t);
-		pixels.resize(buffer_byte_size);
-		PoolByteArray::Write pixel_write = pixels.write();
-		memcpy(pixel_write.ptr(), buffer.ptr(), buffer_byte_size);
-		uint8_t *ptr_pixel_write = pixel_write.ptr();
-		for (int32_t pixel_i = 0; pixel_i < pixels.size(); pixel_i += 4) {
-			SWAP(ptr_pixel_write[pixel_i + 2], ptr_pixel_write[pixel_i + 0]);
-		}
-		Ref<Image> img;
-		img.instance();
-		img->create((int)width, (int)height, false, Image::FORMAT_RGBA8, pixels);
-		Dictionary d = Engine::get_singleton()->get_version_info();
-		Ref<ImageTexture> tex = image_textures.write[frame_godot];
-		tex->create_from_image(img, ImageTexture::FLAG_REPEAT | ImageTexture::FLAG_FILTER);
-		frames->add_frame(name, tex);
-
-		unskipped += skip_frames;
-		frame_godot++;
+	if (profile) {
+		Dictionary layers;
+		layers["precomp"] = (int64_t)model_stats.precompLayerCount;
+		layers["solid"] = (int64_t)model_stats.solidLayerCount;
+		layers["shape"] = (int64_t)model_stats.shapeLayerCount;
+		layers["image"] = (int64_t)model_stats.imageLayerCount;
+		layers["null"] = (int64_t)model_stats.nullLayerCount;
+		Dictionary &report = r_frames.report;
+		report["parse_msec"] = parse_usec / 1000.0;
+		report["render_msec"] = render_usec / 1000.0;
+		report["layers"] = layers;
+		report["frame_update_msec"] = frame_update_msec;
+		report["frame_rasterize_msec"] = frame_rasterize_msec;
+		report["frame_blend_msec"] = frame_blend_msec;
+		report["cached_frames"] = godot_frame_count - render_count;
+		report["threads"] = worker_count;
+		report["lod_levels"] = lod_levels;
+		report["surface_bytes"] = worker_count * buffer_byte_size;
+		report["image_bytes"] = image_bytes;
 	}
+	return OK;
+}
+
+// Shows the frame textures on a sprite, or with animation/import on an
+// animated sprite with one animation per marker.
+static Node *_create_sprite(const ResourceImporterLottie::RenderedFrames &p_frames, const Map<StringName, Variant> &p_options, const Vector<Ref<Texture> > &p_textures) {
+	Ref<SpriteFrames> frames;
+	frames.instance();
+	List<StringName> animations;
+	frames->get_animation_list(&animations);
+	String name = animations[0];
+	frames->set_animation_speed(name, p_frames.animation_speed);
+	const Vector<String> &marker_names = p_frames.marker_names;
+	if (marker_names.size()) {
+		frames->remove_animation(name);
+		for (int32_t marker_i = 0; marker_i < marker_names.size(); marker_i++) {
+			frames->add_animation(marker_names[marker_i]);
+			frames->set_animation_speed(marker_names[marker_i], p_frames.animation_speed);
+			const Vector<int32_t> &marker_frames = p_frames.marker_frames[marker_i];
+			for (int32_t frame_i = 0; frame_i < marker_frames.size(); frame_i++) {
+				frames->add_frame(marker_names[marker_i], p_textures[p_frames.frame_unique_indices[marker_frames[frame_i]]]);
+			}
+		}
+		name = marker_names[0];
+	} else {
+		for (int32_t frame_godot = 0; frame_godot < p_frames.lottie_frames.size(); frame_godot++) {
+			frames->add_frame(name, p_textures[p_frames.frame_unique_indices[frame_godot]]);
+		}
+	}
+
 	Node *root = nullptr;
 	if (p_options["3d"] && !p_options["animation/import"]) {
-		root = memnew(Sprite3D);
-		Sprite3D *sprite = cast_to<Sprite3D>(root);
 		int32_t frame = p_options["start_frame"];
-		Ref<Texture> tex = frames->get_frame("default", frame);
-		ERR_FAIL_COND_V(tex.is_null(), FAILED);
+		Ref<Texture> tex = frames->get_frame(name, frame);
+		ERR_FAIL_COND_V(tex.is_null(), nullptr);
+		root = memnew(Sprite3D);
+		Sprite3D *sprite = Object::cast_to<Sprite3D>(root);
 		sprite->set_texture(tex);
 		sprite->set_draw_flag(SpriteBase3D::FLAG_SHADED, true);
 	} else if (!p_options["3d"] && !p_options["animation/import"]) {
-		root = memnew(Sprite);
-		Sprite *sprite = cast_to<Sprite>(root);
 		int32_t frame = p_options["start_frame"];
-		Ref<Texture> tex = frames->get_frame("default", frame);
-		ERR_FAIL_COND_V(tex.is_null(), FAILED);
+		Ref<Texture> tex = frames->get_frame(name, frame);
+		ERR_FAIL_COND_V(tex.is_null(), nullptr);
+		root = memnew(Sprite);
+		Sprite *sprite = Object::cast_to<Sprite>(root);
 		sprite->set_texture(tex);
 	} else if (p_options["3d"] && p_options["animation/import"]) {
 		root = memnew(AnimatedSprite3D);
-		AnimatedSprite3D *animate_sprite = cast_to<AnimatedSprite3D>(root);
+		AnimatedSprite3D *animate_sprite = Object::cast_to<AnimatedSprite3D>(root);
 		if (p_options["animation/begin_playing"]) {
 			animate_sprite->call("_set_playing", true);
 		}
 		animate_sprite->set_draw_flag(SpriteBase3D::FLAG_SHADED, true);
-		animate_sprite->set_frame(p_options["start_frame"]);
 		animate_sprite->set_sprite_frames(frames);
+		animate_sprite->set_animation(name);
+		animate_sprite->set_frame(p_options["start_frame"]);
 	} else {
 		root = memnew(AnimatedSprite);
-		AnimatedSprite *animate_sprite = cast_to<AnimatedSprite>(root);
+		AnimatedSprite *animate_sprite = Object::cast_to<AnimatedSprite>(root);
 		if (p_options["animation/begin_playing"]) {
 			animate_sprite->call("_set_playing", true);
 		}
-		animate_sprite->set_frame(p_options["start_frame"]);
 		animate_sprite->set_sprite_frames(frames);
+		animate_sprite->set_animation(name);
+		animate_sprite->set_frame(p_options["start_frame"]);
+	}
+	return root;
+}
+
+// Every unique frame gets its own texture. Cached frames are loaded from the
+// frame cache and streamed ones were saved while rendering.
+static Node *_build_frames_scene(ResourceImporterLottie::RenderedFrames &p_frames, const Map<StringName, Variant> &p_options, Vector<Ref<Texture> > &r_textures) {
+	for (int32_t cached_i = 0; cached_i < p_frames.cached_slots.size(); cached_i++) {
+		String slot_path = _get_cache_path(p_frames.cache_key, "_" + itos(p_frames.cached_slots[cached_i]) + ".res");
+		Ref<Texture> tex = ResourceLoader::load(slot_path, "Texture", true);
+		if (tex.is_null()) {
+			// The next import renders the frames of the entry again.
+			_remove_cache_entry(p_frames.cache_key);
+			ERR_FAIL_V(nullptr);
+		}
+		r_textures.push_back(tex);
+	}
+	if (p_frames.streaming) {
+		for (int32_t unique_i = 0; unique_i < p_frames.stream_textures.size(); unique_i++) {
+			r_textures.push_back(p_frames.stream_textures[unique_i]);
+		}
+	} else {
+		for (int32_t unique_i = 0; unique_i < p_frames.unique_images.size(); unique_i++) {
+			r_textures.push_back(_create_frame_texture(p_frames.unique_images[unique_i], p_frames.trim ? p_frames.unique_used_rects[unique_i] : Rect2(), p_frames.trim, p_frames.lossy));
+		}
+	}
+	p_frames.unique_images.clear();
+	return _create_sprite(p_frames, p_options, r_textures);
+}
+
+// Every page becomes a texture and every frame an AtlasTexture of its region.
+// The margin restores the trimmed offset, so sprites place each frame as
+// before.
+static Node *_build_atlas_scene(ResourceImporterLottie::RenderedFrames &p_frames, const Map<StringName, Variant> &p_options, Vector<Ref<Texture> > &r_textures) {
+	Vector<Ref<Texture> > pages;
+	for (int32_t page_i = 0; page_i < p_frames.atlas_pages.size(); page_i++) {
+		pages.push_back(_create_texture(p_frames.atlas_pages[page_i], p_frames.lossy, ImageTexture::FLAG_FILTER));
+	}
+	p_frames.atlas_pages.clear();
+	Size2 frame_size(p_frames.width, p_frames.height);
+	for (int32_t unique_i = 0; unique_i < p_frames.atlas_regions.size(); unique_i++) {
+		const Rect2 &used_rect = p_frames.unique_used_rects[unique_i];
+		Ref<AtlasTexture> tex;
+		tex.instance();
+		tex->set_atlas(pages[p_frames.atlas_page_indices[unique_i]]);
+		tex->set_region(p_frames.atlas_regions[unique_i]);
+		tex->set_margin(Rect2(used_rect.position, frame_size - used_rect.size));
+		tex->set_filter_clip(true);
+		r_textures.push_back(tex);
+	}
+	return _create_sprite(p_frames, p_options, r_textures);
+}
+
+// One layer per frame, so the shader maps frames to layers directly.
+static Node *_build_texture_array_scene(ResourceImporterLottie::RenderedFrames &p_frames, const Map<StringName, Variant> &p_options, Vector<Ref<Texture> > &r_textures) {
+	int32_t frame_count = p_frames.lottie_frames.size();
+	Ref<TextureArray> texture_array;
+	texture_array.instance();
+	texture_array->create(p_frames.width, p_frames.height, frame_count, Image::FORMAT_RGBA8, Texture::FLAG_FILTER | Texture::FLAG_CONVERT_TO_LINEAR);
+	for (int32_t frame_godot = 0; frame_godot < frame_count; frame_godot++) {
+		texture_array->set_layer_data(p_frames.unique_images[p_frames.frame_unique_indices[frame_godot]], frame_godot);
+	}
+	p_frames.unique_images.clear();
+	return _create_texture_array_sprite(texture_array, p_frames.animation_speed, p_options["start_frame"], p_options["animation/begin_playing"]);
+}
+
+static Node *_build_delta_scene(ResourceImporterLottie::RenderedFrames &p_frames, const Map<StringName, Variant> &p_options, Vector<Ref<Texture> > &r_textures) {
+	Ref<LottieDeltaTexture> delta_texture;
+	delta_texture.instance();
+	delta_texture->create(p_frames.width, p_frames.height);
+	for (int32_t frame_i = 0; frame_i < p_frames.delta_rects.size(); frame_i++) {
+		delta_texture->add_frame(p_frames.delta_rects[frame_i], p_frames.delta_data[frame_i], p_frames.delta_keyframes[frame_i]);
+	}
+	p_frames.delta_data.clear();
+	delta_texture->set_frame_rate(p_frames.animation_speed);
+	delta_texture->set_current_frame(p_options["start_frame"]);
+	delta_texture->set_playing(bool(p_options["animation/import"]) && bool(p_options["animation/begin_playing"]));
+	if (p_options["3d"]) {
+		Sprite3D *sprite = memnew(Sprite3D);
+		sprite->set_texture(delta_texture);
+		sprite->set_draw_flag(SpriteBase3D::FLAG_SHADED, true);
+		return sprite;
+	}
+	Sprite *sprite = memnew(Sprite);
+	sprite->set_texture(delta_texture);
+	return sprite;
+}
+
+static Node *_build_mesh_scene(ResourceImporterLottie::RenderedFrames &p_frames, const Map<StringName, Variant> &p_options, Vector<Ref<Texture> > &r_textures) {
+	Vector<String> animation_names = p_frames.marker_names;
+	Vector<Vector<int32_t> > animation_frames = p_frames.marker_frames;
+	if (animation_names.empty()) {
+		Vector<int32_t> all_frames;
+		for (int32_t frame_godot = 0; frame_godot < p_frames.lottie_frames.size(); frame_godot++) {
+			all_frames.push_back(frame_godot);
+		}
+		// The name SpriteFrames gives its first animation.
+		animation_names.push_back("default");
+		animation_frames.push_back(all_frames);
+	}
+	return _create_mesh_scene(p_frames.mesh_arrays, p_frames.frame_unique_indices, animation_names, animation_frames, p_frames.animation_speed, p_options["3d"], p_options["animation/import"], p_options["animation/begin_playing"], p_options["start_frame"]);
+}
+
+// Palette indexed frames are expanded by the material of the sprite.
+static Node *_build_palette_scene(ResourceImporterLottie::RenderedFrames &p_frames, const Map<StringName, Variant> &p_options, Vector<Ref<Texture> > &r_textures) {
+	for (int32_t unique_i = 0; unique_i < p_frames.unique_images.size(); unique_i++) {
+		r_textures.push_back(_create_texture(p_frames.unique_images[unique_i], false, 0));
+	}
+	p_frames.unique_images.clear();
+	Node *root = _create_sprite(p_frames, p_options, r_textures);
+	ERR_FAIL_COND_V(!root, nullptr);
+	Object::cast_to<CanvasItem>(root)->set_material(_create_palette_material(p_frames.palette));
+	return root;
+}
+
+Error ResourceImporterLottie::save_scene(const String &p_source_file, const String &p_save_path, const Map<StringName, Variant> &p_options, RenderedFrames &p_frames, List<String> *r_gen_files, Variant *r_metadata) {
+	Vector<Ref<Texture> > unique_textures;
+	Node *root = nullptr;
+	switch (p_frames.storage_mode) {
+		case STORAGE_ATLAS:
+			root = _build_atlas_scene(p_frames, p_options, unique_textures);
+			break;
+		case STORAGE_TEXTURE_ARRAY:
+			root = _build_texture_array_scene(p_frames, p_options, unique_textures);
+			break;
+		case STORAGE_DELTA:
+			root = _build_delta_scene(p_frames, p_options, unique_textures);
+			break;
+		case STORAGE_MESH:
+			root = _build_mesh_scene(p_frames, p_options, unique_textures);
+			break;
+		case STORAGE_PALETTE:
+			root = _build_palette_scene(p_frames, p_options, unique_textures);
+			break;
+		default:
+			root = _build_frames_scene(p_frames, p_options, unique_textures);
+	}
+	ERR_FAIL_COND_V(!root, FAILED);
+	for (int32_t stream_i = 0; stream_i < p_frames.stream_paths.size(); stream_i++) {
+		r_gen_files->push_back(p_frames.stream_paths[stream_i]);
+	}
+	if (p_frames.use_cache) {
+		if (p_frames.uncached_frames.size()) {
+			_store_cached_frames(p_frames.cache_key, p_frames.cache_index, unique_textures, p_frames.cached_slots.size(), p_frames.lottie_frames, p_frames.uncached_frames, p_frames.frame_unique_indices);
+		}
+		_touch_cache_entry(p_source_file, p_frames.cache_key);
 	}
 	Ref<PackedScene> scene;
 	scene.instance();
 	scene->pack(root);
+	memdelete(root);
 	String save_path = p_save_path + ".scn";
 	r_gen_files->push_back(save_path);
-	return ResourceSaver::save(save_path, scene);
-}
\ No newline at end of file
+	Error err = ResourceSaver::save(save_path, scene);
+	if (err != OK || p_frames.report.empty()) {
+		return err;
+	}
+
+	Dictionary report = p_frames.report;
+	PoolIntArray texture_bytes = p_frames.streaming ? _get_file_sizes(p_frames.stream_paths) : _get_texture_sizes(unique_textures);
+	report["texture_bytes"] = texture_bytes;
+	FileAccess *scene_file = FileAccess::open(save_path, FileAccess::READ);
+	if (scene_file) {
+		report["scene_bytes"] = (int64_t)scene_file->get_len();
+		memdelete(scene_file);
+	}
+	if (r_metadata) {
+		Dictionary metadata;
+		metadata["profile"] = report;
+		*r_metadata = metadata;
+	}
+	print_line(vformat("Lottie import of %s: parse %.1f ms, render %.1f ms for %d frames on %d threads, %d unique frames in %d textures.",
+			p_source_file, report["parse_msec"], report["render_msec"], p_frames.lottie_frames.size(), report["threads"], unique_textures.size(), texture_bytes.size()));
+	return OK;
+}
+
+Error ResourceImporterLottie::import(const String &p_source_file, const String &p_save_path, const Map<StringName, Variant> &p_options, List<String> *r_platform_variants, List<String> *r_gen_files, Variant *r_metadata) {
+	RenderedFrames frames;
+	Error err = render_frames(p_source_file, p_save_path, p_options, frames);
+	ERR_FAIL_COND_V(err != OK, err);
+	return save_scene(p_source_file, p_save_path, p_options, frames, r_gen_files, r_metadata);
+}
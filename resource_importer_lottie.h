@@ -30,17 +30,101 @@
 #ifndef RESOURCE_IMPORTER_LOTTIE
 #define RESOURCE_IMPORTER_LOTTIE
 
+#include "core/image.h"
+#include "core/io/config_file.h"
 #include "core/io/resource_importer.h"
 #include "core/io/resource_saver.h"
 #include "scene/3d/mesh_instance.h"
 #include "scene/3d/spatial.h"
 #include "scene/resources/packed_scene.h"
 #include "scene/resources/primitive_meshes.h"
+#include "scene/resources/texture.h"
 
 class ResourceImporterLottie : public ResourceImporter {
 	GDCLASS(ResourceImporterLottie, ResourceImporter);
 
 public:
+	enum StorageMode {
+		STORAGE_FRAMES,
+		STORAGE_ATLAS,
+		STORAGE_TEXTURE_ARRAY,
+		STORAGE_DELTA,
+		STORAGE_MESH,
+		STORAGE_PALETTE,
+	};
+
+	// A unique frame of a streamed import, saved to path as soon as it is
+	// rendered. texture is the placeholder the scene keeps, null when saving
+	// failed.
+	struct StreamedFrame {
+		Ref<Image> image;
+		Rect2 used_rect;
+		bool trim = false;
+		bool lossy = false;
+		String path;
+		Ref<Texture> texture;
+	};
+	// Saves a streamed frame from the thread that rendered it, it has to reach
+	// save_streamed_frame on the main thread.
+	typedef void (*StreamFunc)(void *p_userdata, StreamedFrame &r_frame);
+
+	// The frames of an import, rendered and packed for their storage mode but
+	// without any texture. render_frames fills it and is safe to call from any
+	// thread, save_scene turns it into the scene on the main thread.
+	struct RenderedFrames {
+		int32_t storage_mode = STORAGE_FRAMES;
+		int32_t width = 0;
+		int32_t height = 0;
+		bool lossy = false;
+		bool trim = false;
+		float animation_speed = 0;
+		Vector<int32_t> lottie_frames;
+		Vector<String> marker_names;
+		Vector<Vector<int32_t> > marker_frames;
+		// Every frame points at a frame cache slot in cached_slots, or past
+		// those at a unique rendered frame.
+		Vector<int32_t> frame_unique_indices;
+		Vector<Ref<Image> > unique_images;
+		Vector<Rect2> unique_used_rects;
+
+		bool use_cache = false;
+		String cache_key;
+		Ref<ConfigFile> cache_index;
+		Vector<int32_t> cached_slots;
+		Vector<int32_t> uncached_frames;
+
+		bool streaming = false;
+		Vector<String> stream_paths;
+		Vector<Ref<Texture> > stream_textures;
+
+		Vector<Ref<Image> > atlas_pages;
+		Vector<int32_t> atlas_page_indices;
+		Vector<Rect2> atlas_regions;
+
+		Vector<uint32_t> palette;
+
+		Vector<Rect2> delta_rects;
+		Vector<PoolVector<uint8_t> > delta_data;
+		Vector<bool> delta_keyframes;
+
+		Vector<Array> mesh_arrays;
+
+		// The profile report, empty unless profile/report is set.
+		Dictionary report;
+	};
+
+	// Parses, renders and packs the frames of p_source_file. Streamed frames
+	// are handed to p_stream_func, or saved right away without one.
+	static Error render_frames(const String &p_source_file, const String &p_save_path,
+			const Map<StringName, Variant> &p_options, RenderedFrames &r_frames,
+			StreamFunc p_stream_func = NULL, void *p_stream_userdata = NULL);
+	static void save_streamed_frame(StreamedFrame &r_frame);
+	// Creates the textures of p_frames with the builder of their storage mode
+	// and saves the scene. Only call it from the main thread.
+	static Error save_scene(const String &p_source_file, const String &p_save_path,
+			const Map<StringName, Variant> &p_options, RenderedFrames &p_frames,
+			List<String> *r_gen_files, Variant *r_metadata = NULL);
+
 	virtual String get_importer_name() const;
 	virtual String get_visible_name() const;
 	virtual void get_recognized_extensions(List<String> *p_extensions) const;
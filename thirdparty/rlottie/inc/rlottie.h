@@ -23,6 +23,9 @@
 #ifndef _RLOTTIE_H_
 #define _RLOTTIE_H_
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <future>
 #include <vector>
 #include <memory>
@@ -64,6 +67,49 @@ namespace rlottie {
  */
 RLOTTIE_API void configureModelCacheSize(size_t cacheSize);
 
+/**
+ *  @brief Configures the worker threads shared by all rendering.
+ *
+ *  Render and rasterization tasks of every Animation run on one pool of
+ *  worker threads. Configuring only records the size, the threads start with
+ *  the first render, so a process that never renders starts none. Without
+ *  configuration it uses one thread per core. Reconfiguring a running pool
+ *  waits for the tasks that are running to finish, so don't call it from a
+ *  render callback.
+ *
+ *  @param[in] threads  number of worker threads, 0 for one per core.
+ *  @param[in] affinityMask  CPUs the workers may run on, bit n for CPU n.
+ *                           0 leaves the affinity alone. Only applied on
+ *                           Linux.
+ *
+ *  @internal
+ */
+RLOTTIE_API void configureThreadPool(size_t threads, uint64_t affinityMask = 0);
+
+/**
+ *  @brief Runs all rendering on a host provided executor instead of
+ *         worker threads of rlottie.
+ *
+ *  rlottie starts no threads of its own, every submitted task posts a
+ *  @p job to @p executor that runs queued tasks until none is left.
+ *
+ *  @param[in] executor runs a job on some thread of the host.
+ *
+ *  @internal
+ */
+RLOTTIE_API void configureThreadPool(
+    std::function<void(std::function<void()> job)> executor);
+
+/**
+ *  @brief Urgency of an asynchronous render.
+ *
+ *  Frames about to be shown are rendered before prefetched ones.
+ */
+enum class RenderPriority {
+    Frame,      /*!< latency critical, the frame is waited on */
+    Background  /*!< prefetching and offline rendering */
+};
+
 struct Color {
     Color() = default;
     Color(float r, float g , float b):_r(r), _g(g), _b(b){}
@@ -268,6 +314,70 @@ using LayerInfoList = std::vector<std::tuple<std::string, int , int>>;
 
 using ColorFilter = std::function<void(float &r , float &g, float &b)>;
 
+/**
+ *  @brief Time spent in each stage of rendering one frame, in milliseconds.
+ *
+ *  Rasterization runs on the RLE worker threads, any part of it still
+ *  pending when blending starts is counted in blend.
+ *
+ *  @see Animation::render
+ */
+struct FrameStats {
+    double update{0};
+    double rasterize{0};
+    double blend{0};
+};
+
+/**
+ *  @brief Cancels asynchronous renders and gives them a deadline.
+ *
+ *  A token is shared between the caller and the renders it was passed to.
+ *  A queued render whose token is cancelled or past its deadline is dropped
+ *  without drawing, a render in progress stops at the next layer. Cancel the
+ *  token of a frame as soon as it was superseded, e.g. when playback skipped
+ *  ahead.
+ *
+ *  @see Animation::render
+ */
+class CancellationToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void cancel() { mCancelled.store(true, std::memory_order_relaxed); }
+
+    /**
+     *  @brief Cancels the renders once @p deadline passed.
+     */
+    void setDeadline(Clock::time_point deadline)
+    {
+        mDeadline.store(deadline.time_since_epoch().count(),
+                        std::memory_order_relaxed);
+    }
+
+    bool isCancelled() const
+    {
+        if (mCancelled.load(std::memory_order_relaxed)) return true;
+        Clock::rep deadline = mDeadline.load(std::memory_order_relaxed);
+        return deadline && Clock::now().time_since_epoch().count() >= deadline;
+    }
+
+private:
+    std::atomic<bool>       mCancelled{false};
+    std::atomic<Clock::rep> mDeadline{0};
+};
+
+/**
+ *  @brief Number of layers of each type in the composition, precomposition
+ *  contents included.
+ */
+struct ModelStats {
+    size_t precompLayerCount{0};
+    size_t solidLayerCount{0};
+    size_t shapeLayerCount{0};
+    size_t imageLayerCount{0};
+    size_t nullLayerCount{0};
+};
+
 class RLOTTIE_API Animation {
 public:
 
@@ -325,6 +435,39 @@ public:
     static std::unique_ptr<Animation>
     loadFromData(std::string jsonData, std::string resourcePath, ColorFilter filter);
 
+    /**
+     *  @brief Constructs an animation object by parsing JSON data in place.
+     *
+     *  The data is not copied, the parser rewrites the buffer while parsing
+     *  and the model keeps no reference to it, so the caller may free or reuse
+     *  it once this returns.
+     *
+     *  @param[in] data Mutable, null terminated JSON data.
+     *  @param[in] key the string that will be used to cache the model.
+     *  @param[in] resourcePath the path will be used to search for external resource.
+     *  @param[in] cachePolicy whether to cache or not the model data.
+     *
+     *  @return Animation object that can render the contents of the
+     *          Lottie resource represented by JSON data.
+     *
+     *  @internal
+     */
+    static std::unique_ptr<Animation>
+    loadFromBuffer(char *data, const std::string &key,
+                   const std::string &resourcePath="", bool cachePolicy=true);
+
+    /**
+     *  @brief Constructs another animation object of the same model.
+     *
+     *  The parsed model is shared and nothing is parsed again, the new object
+     *  has its own renderer so both can render at the same time.
+     *
+     *  @return Animation object that renders the same Lottie resource.
+     *
+     *  @internal
+     */
+    std::unique_ptr<Animation> clone() const;
+
     /**
      *  @brief Returns default framerate of the Lottie resource.
      *
@@ -396,9 +539,16 @@ public:
      *         to draw into the screen.
      *
      *
+     *  Several frames can be in flight at once, up to the size of the
+     *  renderer pool they render in parallel. @see setRendererPoolSize
+     *
      *  @param[in] frameNo Content corresponds to the @p frameNo needs to be drawn
      *  @param[in] surface Surface in which content will be drawn
      *  @param[in] keepAspectRatio whether to keep the aspect ratio while scaling the content.
+     *  @param[in] priority whether the frame is waited on or prefetched.
+     *  @param[out] stats receives the stage timings of this frame before the
+     *                    future is ready, when not null. Timing costs a few
+     *                    clock reads per frame.
      *
      *  @return future that will hold the result when rendering finished.
      *
@@ -407,7 +557,36 @@ public:
      *  @see Surface
      *  @internal
      */
-    std::future<Surface> render(size_t frameNo, Surface surface, bool keepAspectRatio=true);
+    std::future<Surface> render(size_t frameNo, Surface surface, bool keepAspectRatio=true,
+                                RenderPriority priority=RenderPriority::Frame,
+                                FrameStats *stats=nullptr);
+
+    /**
+     *  @brief Renders the content to surface Asynchronously, unless
+     *         @p token is cancelled or expires first.
+     *
+     *  Works like render(), the future of a render that was cancelled
+     *  holds a Surface without buffer. What was drawn into @p surface up to
+     *  then is left there.
+     *
+     *  @param[in] frameNo Content corresponds to the @p frameNo needs to be drawn
+     *  @param[in] surface Surface in which content will be drawn
+     *  @param[in] token cancels the render or gives it a deadline.
+     *  @param[in] keepAspectRatio whether to keep the aspect ratio while scaling the content.
+     *  @param[in] priority whether the frame is waited on or prefetched.
+     *  @param[out] stats receives the stage timings of this frame before the
+     *                    future is ready, unless the render was cancelled.
+     *
+     *  @return future that will hold the result when rendering finished.
+     *
+     *  @see CancellationToken
+     *  @internal
+     */
+    std::future<Surface> render(size_t frameNo, Surface surface,
+                                std::shared_ptr<CancellationToken> token,
+                                bool keepAspectRatio=true,
+                                RenderPriority priority=RenderPriority::Frame,
+                                FrameStats *stats=nullptr);
 
     /**
      *  @brief Renders the content to surface synchronously.
@@ -416,10 +595,83 @@ public:
      *  @param[in] frameNo Content corresponds to the @p frameNo needs to be drawn
      *  @param[in] surface Surface in which content will be drawn
      *  @param[in] keepAspectRatio whether to keep the aspect ratio while scaling the content.
+     *  @param[out] stats receives the stage timings of this frame, when not null.
      *
      *  @internal
      */
-    void              renderSync(size_t frameNo, Surface surface, bool keepAspectRatio=true);
+    void              renderSync(size_t frameNo, Surface surface, bool keepAspectRatio=true,
+                                 FrameStats *stats=nullptr);
+
+    /**
+     *  @brief Renders every @p step th frame from @p startFrame to @p endFrame
+     *         and hands the finished surfaces back in frame order.
+     *
+     *  Several frames are in flight at once, each on its own renderer over the
+     *  shared model, so updating one frame overlaps rasterizing and blending
+     *  the frames before it on the worker pool.
+     *
+     *  Both callbacks run on the calling thread. @p surfaceProvider is asked
+     *  for the surface of a frame right before that frame is scheduled, and a
+     *  surface handed to @p frameReady can be returned by the provider again
+     *  once the callback returned.
+     *
+     *  @param[in] startFrame first frame to render.
+     *  @param[in] endFrame last frame to render, inclusive.
+     *  @param[in] step distance between two rendered frames.
+     *  @param[in] surfaceProvider returns the surface to render a frame into.
+     *  @param[in] frameReady called with every finished frame, in order.
+     *  @param[in] keepAspectRatio whether to keep the aspect ratio while scaling the content.
+     *
+     *  @note The range renders on renderers of its own, one per frame in
+     *        flight. The renderer pool and its size are left alone, renders
+     *        submitted meanwhile still use the pool.
+     *
+     *  @internal
+     */
+    void renderRange(size_t startFrame, size_t endFrame, size_t step,
+                     const std::function<Surface(size_t frameNo)> &surfaceProvider,
+                     const std::function<void(size_t frameNo, const Surface &surface)> &frameReady,
+                     bool keepAspectRatio=true);
+
+    /**
+     *  @brief Sets how many renderers this Animation keeps.
+     *
+     *  Each renderer draws one frame at a time, all of them share the parsed
+     *  model. Renderers are created on demand up to @p count, a render that
+     *  finds none free waits for one. Defaults to 1, so renders run one after
+     *  another unless the pool is made larger.
+     *
+     *  @param[in] count maximum number of frames rendering at the same time.
+     *
+     *  @see render
+     *  @internal
+     */
+    void setRendererPoolSize(size_t count);
+
+    /**
+     *  @brief Returns the size of the renderer pool.
+     *
+     *  @see setRendererPoolSize
+     *  @internal
+     */
+    size_t rendererPoolSize() const;
+
+    /**
+     *  @brief Blends every frame in horizontal bands on the worker threads.
+     *
+     *  Without it a frame is blended on the thread that renders it, only
+     *  rasterization is spread over the workers. With it the surface is split
+     *  into bands that blend in parallel, so the latency of a single large
+     *  frame scales with the number of threads. Surfaces too small to split
+     *  and surfaces with a draw region smaller than the surface render as
+     *  before. Disabled by default.
+     *
+     *  @param[in] enable whether to split frames into bands.
+     *
+     *  @see configureThreadPool
+     *  @internal
+     */
+    void setTiledRendering(bool enable);
 
     /**
      *  @brief Returns root layer of the composition updated with
@@ -457,6 +709,15 @@ public:
      */
     const LayerInfoList& layers() const;
 
+    /**
+     *  @brief Returns the layer counts of the composition.
+     *
+     *  @return ModelStats of the Composition.
+     *
+     *  @internal
+     */
+    ModelStats modelStats() const;
+
     /**
      *  @brief Sets property value for the specified {@link KeyPath}. This {@link KeyPath} can resolve
      *  to multiple contents. In that case, the callback's value will apply to all of them.
@@ -23,8 +23,14 @@
 #include "lottieitem.h"
 #include "lottiemodel.h"
 #include "rlottie.h"
+#include "velapsedtimer.h"
+#include "vtaskscheduler.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <mutex>
 
 using namespace rlottie;
 using namespace rlottie::internal;
@@ -34,30 +40,105 @@ RLOTTIE_API void rlottie::configureModelCacheSize(size_t cacheSize)
     internal::model::configureModelCacheSize(cacheSize);
 }
 
-struct RenderTask {
-    RenderTask() { receiver = sender.get_future(); }
+RLOTTIE_API void rlottie::configureThreadPool(size_t threads,
+                                              uint64_t affinityMask)
+{
+#ifdef LOTTIE_THREAD_SUPPORT
+    TaskScheduler::instance().configure(threads, affinityMask);
+#else
+    (void)threads;
+    (void)affinityMask;
+#endif
+}
+
+RLOTTIE_API void rlottie::configureThreadPool(
+    std::function<void(std::function<void()> job)> executor)
+{
+#ifdef LOTTIE_THREAD_SUPPORT
+    TaskScheduler::instance().configure(std::move(executor));
+#else
+    (void)executor;
+#endif
+}
+
+struct RenderTask : public SchedulerTask {
     std::promise<Surface> sender;
-    std::future<Surface>  receiver;
     AnimationImpl *       playerImpl{nullptr};
     size_t                frameNo{0};
     Surface               surface;
     bool                  keepAspectRatio{true};
+    RenderPriority        priority{RenderPriority::Frame};
+    std::shared_ptr<CancellationToken> token;
+    FrameStats *          stats{nullptr};
+    // reserved when the task is submitted, a task never waits for one on a
+    // worker thread.
+    renderer::Composition *renderer{nullptr};
+    // false for the renderers renderRange() keeps outside the pool.
+    bool                   pooledRenderer{true};
+
+    void run() override;
 };
-using SharedRenderTask = std::shared_ptr<RenderTask>;
+
+#ifdef LOTTIE_THREAD_SUPPORT
+
+/*
+ * As each player draws into its own buffer the render task is delegated to
+ * the worker pool it shares with the rasterization. Submitting only pushes
+ * the pooled task onto a lock free deque of the calling thread.
+ */
+class RenderTaskScheduler {
+public:
+    static RenderTaskScheduler &instance()
+    {
+        static RenderTaskScheduler singleton;
+        return singleton;
+    }
+
+    void process(RenderTask *task)
+    {
+        TaskScheduler::instance().process(
+            task, task->priority == RenderPriority::Background
+                      ? TaskPriority::Background
+                      : TaskPriority::Frame);
+    }
+};
+
+#else
+class RenderTaskScheduler {
+public:
+    static RenderTaskScheduler &instance()
+    {
+        static RenderTaskScheduler singleton;
+        return singleton;
+    }
+
+    void process(RenderTask *task) { task->run(); }
+};
+#endif
 
 class AnimationImpl {
 public:
     void    init(std::shared_ptr<model::Composition> composition);
-    bool    update(size_t frameNo, const VSize &size, bool keepAspectRatio);
     VSize   size() const { return mModel->size(); }
     double  duration() const { return mModel->duration(); }
     double  frameRate() const { return mModel->frameRate(); }
     size_t  totalFrame() const { return mModel->totalFrame(); }
     size_t  frameAtPos(double pos) const { return mModel->frameAtPos(pos); }
     Surface render(size_t frameNo, const Surface &surface,
-                   bool keepAspectRatio);
+                   bool keepAspectRatio, FrameStats *stats);
+    Surface draw(renderer::Composition *renderer, size_t frameNo,
+                 const Surface &surface, bool keepAspectRatio,
+                 RenderPriority priority, const CancellationToken *token,
+                 FrameStats *stats);
     std::future<Surface> renderAsync(size_t frameNo, Surface &&surface,
-                                     bool keepAspectRatio);
+                                     bool           keepAspectRatio,
+                                     RenderPriority priority,
+                                     std::shared_ptr<CancellationToken> token,
+                                     FrameStats *stats);
+    void renderRange(size_t startFrame, size_t endFrame, size_t step,
+                     const std::function<Surface(size_t)> &surfaceProvider,
+                     const std::function<void(size_t, const Surface &)> &frameReady,
+                     bool keepAspectRatio);
     const LOTLayerNode * renderTree(size_t frameNo, const VSize &size);
 
     const LayerInfoList &layerInfoList() const
@@ -68,33 +149,211 @@ public:
         return mLayerList;
     }
     const MarkerList &markers() const { return mModel->markers(); }
+    std::shared_ptr<model::Composition> composition() const
+    {
+        return mComposition;
+    }
+    ModelStats        modelStats() const;
+    void              setTiledRendering(bool enable) { mTiledRendering = enable; }
     void              setValue(const std::string &keypath, LOTVariant &&value);
     void              removeFilter(const std::string &keypath, Property prop);
+    void              setRendererPoolSize(size_t count);
+    size_t            rendererPoolSize() const;
+    void              recycleTask(RenderTask *task);
+    void              releaseRenderer(renderer::Composition *renderer);
 
 private:
-    mutable LayerInfoList                  mLayerList;
-    model::Composition *                   mModel;
-    SharedRenderTask                       mTask;
-    std::atomic<bool>                      mRenderInProgress;
-    std::unique_ptr<renderer::Composition> mRenderer{nullptr};
+    struct RendererSlot {
+        std::unique_ptr<renderer::Composition> renderer;
+        bool                                   busy{false};
+    };
+
+    bool update(renderer::Composition *renderer, size_t frameNo,
+                const VSize &size, bool keepAspectRatio);
+    std::unique_ptr<renderer::Composition> createRenderer();
+    renderer::Composition *acquireRenderer();
+    renderer::Composition *tryAcquireRenderer();
+    std::vector<RenderTask *> takeRunnableTasks();
+    RenderTask *           acquireTask();
+    RenderTask *           prepareTask(size_t frameNo, Surface &&surface,
+                                       bool keepAspectRatio,
+                                       RenderPriority priority,
+                                       std::shared_ptr<CancellationToken> token,
+                                       FrameStats *stats);
+
+    mutable LayerInfoList                           mLayerList;
+    model::Composition *                            mModel;
+    std::shared_ptr<model::Composition>             mComposition;
+    // Slots past mPoolSize are left over from a larger pool and are still
+    // rendering, they are dropped once their render finished.
+    std::vector<std::unique_ptr<RendererSlot>>      mRenderers;
+    size_t                                          mPoolSize{1};
+    // submitted renders that wait for a renderer, in submission order.
+    std::deque<RenderTask *>                        mPendingTasks;
+    // renderTree() hands out a tree that outlives the call, it keeps a
+    // renderer of its own outside the pool.
+    std::unique_ptr<renderer::Composition>          mTreeRenderer;
+    mutable std::mutex                              mPoolMutex;
+    std::condition_variable                         mPoolCondition;
+    // tasks are reused once their render finished, the pool only grows
+    // while more renders are in flight than ever before.
+    std::vector<std::unique_ptr<RenderTask>>        mTasks;
+    std::vector<RenderTask *>                       mFreeTasks;
+    std::atomic<bool>                               mTiledRendering{false};
+    std::vector<std::pair<std::string, LOTVariant>> mValues;
 };
 
+ModelStats AnimationImpl::modelStats() const
+{
+    ModelStats stats;
+    stats.precompLayerCount = mModel->mStats.precompLayerCount;
+    stats.solidLayerCount = mModel->mStats.solidLayerCount;
+    stats.shapeLayerCount = mModel->mStats.shapeLayerCount;
+    stats.imageLayerCount = mModel->mStats.imageLayerCount;
+    stats.nullLayerCount = mModel->mStats.nullLayerCount;
+    return stats;
+}
+
 void AnimationImpl::setValue(const std::string &keypath, LOTVariant &&value)
 {
     if (keypath.empty()) return;
-    mRenderer->setValue(keypath, value);
+    std::lock_guard<std::mutex> lock(mPoolMutex);
+    // kept so renderers added to the pool later resolve the same values.
+    mValues.emplace_back(keypath, value);
+    for (auto &slot : mRenderers) slot->renderer->setValue(keypath, value);
+    if (mTreeRenderer) mTreeRenderer->setValue(keypath, value);
+}
+
+void AnimationImpl::setRendererPoolSize(size_t count)
+{
+    std::vector<RenderTask *> runnable;
+    {
+        std::lock_guard<std::mutex> lock(mPoolMutex);
+        mPoolSize = std::max<size_t>(count, 1);
+        for (size_t i = mRenderers.size(); i > mPoolSize; i--) {
+            if (!mRenderers[i - 1]->busy)
+                mRenderers.erase(mRenderers.begin() + (i - 1));
+        }
+        runnable = takeRunnableTasks();
+    }
+    mPoolCondition.notify_all();
+    for (auto task : runnable) RenderTaskScheduler::instance().process(task);
+}
+
+size_t AnimationImpl::rendererPoolSize() const
+{
+    std::lock_guard<std::mutex> lock(mPoolMutex);
+    return mPoolSize;
+}
+
+std::unique_ptr<renderer::Composition> AnimationImpl::createRenderer()
+{
+    auto renderer = std::make_unique<renderer::Composition>(mComposition);
+    for (auto &value : mValues) renderer->setValue(value.first, value.second);
+    return renderer;
+}
+
+// mPoolMutex held, nullptr when every renderer of the pool is busy.
+renderer::Composition *AnimationImpl::tryAcquireRenderer()
+{
+    size_t count = std::min(mRenderers.size(), mPoolSize);
+    for (size_t i = 0; i < count; i++) {
+        if (!mRenderers[i]->busy) {
+            mRenderers[i]->busy = true;
+            return mRenderers[i]->renderer.get();
+        }
+    }
+    if (mRenderers.size() < mPoolSize) {
+        auto slot = std::make_unique<RendererSlot>();
+        slot->renderer = createRenderer();
+        slot->busy = true;
+        mRenderers.push_back(std::move(slot));
+        return mRenderers.back()->renderer.get();
+    }
+    return nullptr;
+}
+
+// mPoolMutex held, hands free renderers to the waiting tasks in order.
+std::vector<RenderTask *> AnimationImpl::takeRunnableTasks()
+{
+    std::vector<RenderTask *> runnable;
+    while (!mPendingTasks.empty()) {
+        renderer::Composition *renderer = tryAcquireRenderer();
+        if (!renderer) break;
+        RenderTask *task = mPendingTasks.front();
+        mPendingTasks.pop_front();
+        task->renderer = renderer;
+        runnable.push_back(task);
+    }
+    return runnable;
+}
+
+// Only for the calling thread of a synchronous render, tasks on the workers
+// get their renderer reserved when they are submitted.
+renderer::Composition *AnimationImpl::acquireRenderer()
+{
+    std::unique_lock<std::mutex> lock(mPoolMutex);
+    while (true) {
+        if (auto renderer = tryAcquireRenderer()) return renderer;
+        mPoolCondition.wait(lock);
+    }
+}
+
+void AnimationImpl::releaseRenderer(renderer::Composition *renderer)
+{
+    std::vector<RenderTask *> runnable;
+    {
+        std::lock_guard<std::mutex> lock(mPoolMutex);
+        for (size_t i = 0; i < mRenderers.size(); i++) {
+            if (mRenderers[i]->renderer.get() != renderer) continue;
+            if (i < mPoolSize) {
+                mRenderers[i]->busy = false;
+            } else {
+                mRenderers.erase(mRenderers.begin() + i);
+            }
+            break;
+        }
+        // submitted renders come before synchronous ones waiting.
+        runnable = takeRunnableTasks();
+    }
+    mPoolCondition.notify_one();
+    for (auto task : runnable) RenderTaskScheduler::instance().process(task);
+}
+
+RenderTask *AnimationImpl::acquireTask()
+{
+    std::lock_guard<std::mutex> lock(mPoolMutex);
+    if (mFreeTasks.empty()) {
+        mTasks.push_back(std::make_unique<RenderTask>());
+        return mTasks.back().get();
+    }
+    RenderTask *task = mFreeTasks.back();
+    mFreeTasks.pop_back();
+    return task;
+}
+
+void AnimationImpl::recycleTask(RenderTask *task)
+{
+    std::lock_guard<std::mutex> lock(mPoolMutex);
+    mFreeTasks.push_back(task);
 }
 
 const LOTLayerNode *AnimationImpl::renderTree(size_t frameNo, const VSize &size)
 {
-    if (update(frameNo, size, true)) {
-        mRenderer->buildRenderTree();
+    renderer::Composition *renderer;
+    {
+        std::lock_guard<std::mutex> lock(mPoolMutex);
+        if (!mTreeRenderer) mTreeRenderer = createRenderer();
+        renderer = mTreeRenderer.get();
     }
-    return mRenderer->renderTree();
+    if (update(renderer, frameNo, size, true)) {
+        renderer->buildRenderTree();
+    }
+    return renderer->renderTree();
 }
 
-bool AnimationImpl::update(size_t frameNo, const VSize &size,
-                           bool keepAspectRatio)
+bool AnimationImpl::update(renderer::Composition *renderer, size_t frameNo,
+                           const VSize &size, bool keepAspectRatio)
 {
     frameNo += mModel->startFrame();
 
@@ -102,150 +361,173 @@ bool AnimationImpl::update(size_t frameNo, const VSize &size,
 
     if (frameNo < mModel->startFrame()) frameNo = mModel->startFrame();
 
-    return mRenderer->update(int(frameNo), size, keepAspectRatio);
+    return renderer->update(int(frameNo), size, keepAspectRatio);
 }
 
 Surface AnimationImpl::render(size_t frameNo, const Surface &surface,
-                              bool keepAspectRatio)
+                              bool keepAspectRatio, FrameStats *stats)
 {
-    bool renderInProgress = mRenderInProgress.load();
-    if (renderInProgress) {
-        vCritical << "Already Rendering Scheduled for this Animation";
-        return surface;
-    }
+    // Waits for a free renderer once as many renders as the pool holds are
+    // in progress.
+    renderer::Composition *renderer = acquireRenderer();
+    Surface result = draw(renderer, frameNo, surface, keepAspectRatio,
+                          RenderPriority::Frame, nullptr, stats);
+    releaseRenderer(renderer);
+    return result;
+}
 
-    mRenderInProgress.store(true);
+Surface AnimationImpl::draw(renderer::Composition *renderer, size_t frameNo,
+                            const Surface &surface, bool keepAspectRatio,
+                            RenderPriority priority,
+                            const CancellationToken *token, FrameStats *stats)
+{
+    if (token && token->isCancelled()) return Surface();
+
+    renderer->setTiledRendering(mTiledRendering);
+    // timed into a local, so the caller never sees the stats of a frame that
+    // was cancelled half way.
+    FrameStats             frameStats;
+    VElapsedTimer          timer;
+    if (stats) timer.start();
     update(
-        frameNo,
+        renderer, frameNo,
         VSize(int(surface.drawRegionWidth()), int(surface.drawRegionHeight())),
         keepAspectRatio);
-    mRenderer->render(surface);
-    mRenderInProgress.store(false);
+    bool finished;
+    if (stats) {
+        frameStats.update = timer.elapsed();
+        finished = renderer->render(surface, &frameStats, token, priority);
+    } else {
+        finished = renderer->render(surface, nullptr, token, priority);
+    }
+    if (stats && finished) *stats = frameStats;
 
-    return surface;
+    return finished ? surface : Surface();
 }
 
 void AnimationImpl::init(std::shared_ptr<model::Composition> composition)
 {
     mModel = composition.get();
-    mRenderer = std::make_unique<renderer::Composition>(composition);
-    mRenderInProgress = false;
+    mComposition = std::move(composition);
+    auto slot = std::make_unique<RendererSlot>();
+    slot->renderer = createRenderer();
+    mRenderers.push_back(std::move(slot));
 }
 
-#ifdef LOTTIE_THREAD_SUPPORT
-
-#include <thread>
-#include "vtaskqueue.h"
-
-/*
- * Implement a task stealing schduler to perform render task
- * As each player draws into its own buffer we can delegate this
- * task to a slave thread. The scheduler creates a threadpool depending
- * on the number of cores available in the system and does a simple fair
- * scheduling by assigning the task in a round-robin fashion. Each thread
- * in the threadpool has its own queue. once it finishes all the task on its
- * own queue it goes through rest of the queue and looks for task if it founds
- * one it steals the task from it and executes. if it couldn't find one then it
- * just waits for new task on its own queue.
- */
-class RenderTaskScheduler {
-    const unsigned           _count{std::thread::hardware_concurrency()};
-    std::vector<std::thread> _threads;
-    std::vector<TaskQueue<SharedRenderTask>> _q{_count};
-    std::atomic<unsigned>                    _index{0};
+void RenderTask::run()
+{
+    // a superseded or expired render is dropped without drawing.
+    Surface result = playerImpl->draw(renderer, frameNo, surface,
+                                      keepAspectRatio, priority, token.get(),
+                                      stats);
+    // back to the pool before the result is published, the Animation may be
+    // gone as soon as the future is ready. Releasing the renderer submits the
+    // next render waiting for one.
+    std::promise<Surface> promise = std::move(sender);
+    AnimationImpl *impl = playerImpl;
+    if (pooledRenderer) impl->releaseRenderer(renderer);
+    renderer = nullptr;
+    token.reset();
+    stats = nullptr;
+    impl->recycleTask(this);
+    promise.set_value(result);
+}
 
-    void run(unsigned i)
-    {
-        while (true) {
-            bool             success = false;
-            SharedRenderTask task;
-            for (unsigned n = 0; n != _count * 2; ++n) {
-                if (_q[(i + n) % _count].try_pop(task)) {
-                    success = true;
-                    break;
-                }
-            }
-            if (!success && !_q[i].pop(task)) break;
+RenderTask *AnimationImpl::prepareTask(
+    size_t frameNo, Surface &&surface, bool keepAspectRatio,
+    RenderPriority priority, std::shared_ptr<CancellationToken> token,
+    FrameStats *stats)
+{
+    RenderTask *task = acquireTask();
+    task->sender = std::promise<Surface>();
+    task->playerImpl = this;
+    task->frameNo = frameNo;
+    task->surface = std::move(surface);
+    task->keepAspectRatio = keepAspectRatio;
+    task->priority = priority;
+    task->token = std::move(token);
+    task->stats = stats;
+    task->pooledRenderer = true;
+    return task;
+}
 
-            auto result = task->playerImpl->render(task->frameNo, task->surface,
-                                                   task->keepAspectRatio);
-            task->sender.set_value(result);
-        }
-    }
+std::future<Surface> AnimationImpl::renderAsync(
+    size_t frameNo, Surface &&surface, bool keepAspectRatio,
+    RenderPriority priority, std::shared_ptr<CancellationToken> token,
+    FrameStats *stats)
+{
+    // Several renders can be in flight at once, up to one per renderer of the
+    // pool. The others wait here instead of blocking a worker thread, and
+    // are submitted as renderers free up.
+    RenderTask *task = prepareTask(frameNo, std::move(surface), keepAspectRatio,
+                                   priority, std::move(token), stats);
+    auto receiver = task->sender.get_future();
 
-    RenderTaskScheduler()
     {
-        for (unsigned n = 0; n != _count; ++n) {
-            _threads.emplace_back([&, n] { run(n); });
+        std::lock_guard<std::mutex> lock(mPoolMutex);
+        task->renderer = mPendingTasks.empty() ? tryAcquireRenderer() : nullptr;
+        if (!task->renderer) {
+            mPendingTasks.push_back(task);
+            return receiver;
         }
     }
+    RenderTaskScheduler::instance().process(task);
+    return receiver;
+}
 
-public:
-    static RenderTaskScheduler &instance()
-    {
-        static RenderTaskScheduler singleton;
-        return singleton;
-    }
-
-    ~RenderTaskScheduler()
-    {
-        for (auto &e : _q) e.done();
-
-        for (auto &e : _threads) e.join();
-    }
-
-    std::future<Surface> process(SharedRenderTask task)
-    {
-        auto receiver = std::move(task->receiver);
-        auto i = _index++;
-
-        for (unsigned n = 0; n != _count; ++n) {
-            if (_q[(i + n) % _count].try_push(std::move(task))) return receiver;
-        }
-
-        if (_count > 0) {
-            _q[i % _count].push(std::move(task));
-        }
+void AnimationImpl::renderRange(
+    size_t startFrame, size_t endFrame, size_t step,
+    const std::function<Surface(size_t)> &              surfaceProvider,
+    const std::function<void(size_t, const Surface &)> &frameReady,
+    bool                                                keepAspectRatio)
+{
+    if (startFrame > endFrame || !surfaceProvider || !frameReady) return;
+    if (step == 0) step = 1;
 
-        return receiver;
-    }
-};
+    size_t count = (endFrame - startFrame) / step + 1;
 
+    // A renderer updates and draws one frame at a time, so the range keeps a
+    // renderer per frame in flight. While one renderer updates its tree for a
+    // frame the others rasterize and blend the frames scheduled before it.
+    // They are the range's own, the pool and renders submitted meanwhile are
+    // left alone.
+#ifdef LOTTIE_THREAD_SUPPORT
+    size_t workers = TaskScheduler::instance().concurrency();
 #else
-class RenderTaskScheduler {
-public:
-    static RenderTaskScheduler &instance()
-    {
-        static RenderTaskScheduler singleton;
-        return singleton;
-    }
+    size_t workers = 1;
+#endif
+    workers = std::min(workers, count);
 
-    std::future<Surface> process(SharedRenderTask task)
+    std::vector<std::unique_ptr<renderer::Composition>> renderers;
     {
-        auto result = task->playerImpl->render(task->frameNo, task->surface,
-                                               task->keepAspectRatio);
-        task->sender.set_value(result);
-        return std::move(task->receiver);
+        std::lock_guard<std::mutex> lock(mPoolMutex);
+        for (size_t i = 0; i < workers; i++)
+            renderers.push_back(createRenderer());
     }
-};
-#endif
 
-std::future<Surface> AnimationImpl::renderAsync(size_t    frameNo,
-                                                Surface &&surface,
-                                                bool      keepAspectRatio)
-{
-    if (!mTask) {
-        mTask = std::make_shared<RenderTask>();
-    } else {
-        mTask->sender = std::promise<Surface>();
-        mTask->receiver = mTask->sender.get_future();
+    std::vector<Surface>              surfaces(workers);
+    std::vector<std::future<Surface>> renders(workers);
+    auto schedule = [&](size_t i) {
+        size_t worker = i % workers;
+        size_t frameNo = startFrame + i * step;
+        surfaces[worker] = surfaceProvider(frameNo);
+        RenderTask *task =
+            prepareTask(frameNo, Surface(surfaces[worker]), keepAspectRatio,
+                        RenderPriority::Frame, nullptr, nullptr);
+        task->renderer = renderers[worker].get();
+        task->pooledRenderer = false;
+        renders[worker] = task->sender.get_future();
+        RenderTaskScheduler::instance().process(task);
+    };
+
+    for (size_t i = 0; i < workers; i++) schedule(i);
+
+    for (size_t i = 0; i < count; i++) {
+        size_t worker = i % workers;
+        renders[worker].get();
+        frameReady(startFrame + i * step, surfaces[worker]);
+        if (i + workers < count) schedule(i + workers);
     }
-    mTask->playerImpl = this;
-    mTask->frameNo = frameNo;
-    mTask->surface = std::move(surface);
-    mTask->keepAspectRatio = keepAspectRatio;
-
-    return RenderTaskScheduler::instance().process(mTask);
 }
 
 /**
@@ -292,6 +574,32 @@ std::unique_ptr<Animation> Animation::loadFromData(std::string jsonData,
     return nullptr;
 }
 
+std::unique_ptr<Animation> Animation::loadFromBuffer(
+    char *data, const std::string &key, const std::string &resourcePath,
+    bool cachePolicy)
+{
+    if (!data || !*data) {
+        vWarning << "jason data is empty";
+        return nullptr;
+    }
+
+    auto composition =
+        model::loadFromBuffer(data, key, resourcePath, cachePolicy);
+    if (composition) {
+        auto animation = std::unique_ptr<Animation>(new Animation);
+        animation->d->init(std::move(composition));
+        return animation;
+    }
+    return nullptr;
+}
+
+std::unique_ptr<Animation> Animation::clone() const
+{
+    auto animation = std::unique_ptr<Animation>(new Animation);
+    animation->d->init(d->composition());
+    return animation;
+}
+
 std::unique_ptr<Animation> Animation::loadFromFile(const std::string &path,
                                                    bool cachePolicy)
 {
@@ -344,15 +652,39 @@ const LOTLayerNode *Animation::renderTree(size_t frameNo, size_t width,
 }
 
 std::future<Surface> Animation::render(size_t frameNo, Surface surface,
-                                       bool keepAspectRatio)
+                                       bool           keepAspectRatio,
+                                       RenderPriority priority,
+                                       FrameStats *   stats)
 {
-    return d->renderAsync(frameNo, std::move(surface), keepAspectRatio);
+    return d->renderAsync(frameNo, std::move(surface), keepAspectRatio,
+                          priority, nullptr, stats);
+}
+
+std::future<Surface> Animation::render(size_t frameNo, Surface surface,
+                                       std::shared_ptr<CancellationToken> token,
+                                       bool           keepAspectRatio,
+                                       RenderPriority priority,
+                                       FrameStats *   stats)
+{
+    return d->renderAsync(frameNo, std::move(surface), keepAspectRatio,
+                          priority, std::move(token), stats);
 }
 
 void Animation::renderSync(size_t frameNo, Surface surface,
-                           bool keepAspectRatio)
+                           bool keepAspectRatio, FrameStats *stats)
 {
-    d->render(frameNo, surface, keepAspectRatio);
+    d->render(frameNo, surface, keepAspectRatio, stats);
+}
+
+void Animation::renderRange(
+    size_t startFrame, size_t endFrame, size_t step,
+    const std::function<Surface(size_t frameNo)> &surfaceProvider,
+    const std::function<void(size_t frameNo, const Surface &surface)>
+        &frameReady,
+    bool keepAspectRatio)
+{
+    d->renderRange(startFrame, endFrame, step, surfaceProvider, frameReady,
+                   keepAspectRatio);
 }
 
 const LayerInfoList &Animation::layers() const
@@ -365,6 +697,26 @@ const MarkerList &Animation::markers() const
     return d->markers();
 }
 
+ModelStats Animation::modelStats() const
+{
+    return d->modelStats();
+}
+
+void Animation::setRendererPoolSize(size_t count)
+{
+    d->setRendererPoolSize(count);
+}
+
+size_t Animation::rendererPoolSize() const
+{
+    return d->rendererPoolSize();
+}
+
+void Animation::setTiledRendering(bool enable)
+{
+    d->setTiledRendering(enable);
+}
+
 void Animation::setValue(Color_Type, Property prop, const std::string &keypath,
                          Color value)
 {
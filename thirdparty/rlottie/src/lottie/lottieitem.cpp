@@ -26,9 +26,15 @@
 #include <iterator>
 #include "lottiekeypath.h"
 #include "vbitmap.h"
+#include "velapsedtimer.h"
 #include "vpainter.h"
 #include "vraster.h"
 
+#ifdef LOTTIE_THREAD_SUPPORT
+#include <condition_variable>
+#include "vtaskscheduler.h"
+#endif
+
 /* Lottie Layer Rules
  * 1. time stretch is pre calculated and applied to all the properties of the
  * lottilayer model and all its children
@@ -106,6 +112,58 @@ renderer::Composition::Composition(std::shared_ptr<model::Composition> model)
     mViewSize = mModel->size();
 }
 
+#ifdef LOTTIE_THREAD_SUPPORT
+/*
+ * The horizontal bands of a tiled frame. Every band walks the whole layer
+ * tree but only blends the spans inside it, the surfaces of mattes and
+ * precomps are only as large as the band.
+ */
+struct renderer::Composition::Tiles {
+    struct Task : public SchedulerTask {
+        Tiles *      tiles{nullptr};
+        Composition *composition{nullptr};
+        VRect        rect;
+        SurfaceCache cache;
+
+        void run() override
+        {
+            composition->renderTile(rect, cache);
+            tiles->finished();
+        }
+    };
+
+    void finished()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) done.notify_one();
+    }
+
+    void wait()
+    {
+        // the workers may be busy with other frames waiting on their own
+        // tiles, queued tiles run on this thread until none is left.
+        while (pending.load(std::memory_order_acquire) &&
+               TaskScheduler::instance().runPending(priority))
+            ;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (pending) done.wait(lock);
+    }
+
+    std::vector<std::unique_ptr<Task>> tasks;
+    // the bands of a background render must not get ahead of frame renders.
+    TaskPriority                       priority{TaskPriority::Raster};
+    std::atomic<size_t>                pending{0};
+    std::mutex                         mutex;
+    std::condition_variable            done;
+};
+#else
+struct renderer::Composition::Tiles {
+};
+#endif
+
+renderer::Composition::~Composition() = default;
+
 void renderer::Composition::setValue(const std::string &keypath,
                                      LOTVariant &       value)
 {
@@ -147,8 +205,16 @@ bool renderer::Composition::update(int frameNo, const VSize &size,
     return true;
 }
 
-bool renderer::Composition::render(const rlottie::Surface &surface)
+bool renderer::Composition::render(const rlottie::Surface &surface,
+                                   rlottie::FrameStats *     stats,
+                                   const rlottie::CancellationToken *token,
+                                   rlottie::RenderPriority   priority)
 {
+    if (token && token->isCancelled()) return false;
+
+    VElapsedTimer timer;
+    if (stats) timer.start();
+
     mSurface.reset(reinterpret_cast<uchar *>(surface.buffer()),
                    uint(surface.width()), uint(surface.height()),
                    uint(surface.bytesPerLine()),
@@ -159,15 +225,117 @@ bool renderer::Composition::render(const rlottie::Surface &surface)
     VRect clip(0, 0, int(surface.drawRegionWidth()),
                int(surface.drawRegionHeight()));
     mRootLayer->preprocess(clip);
+    if (stats) stats->rasterize = timer.restart();
 
-    VPainter painter(&mSurface);
-    // set sub surface area for drawing.
-    painter.setDrawRegion(
-        VRect(int(surface.drawRegionPosX()), int(surface.drawRegionPosY()),
-              int(surface.drawRegionWidth()), int(surface.drawRegionHeight())));
-    mRootLayer->render(&painter, {}, {}, mSurfaceCache);
+    // the scheduled rasterization finishes on its own, a later frame waits
+    // for it before it rasterizes again.
+    if (token && token->isCancelled()) return false;
+
+    size_t tiles = tileCount(surface);
+    if (tiles > 1) {
+        renderTiles(tiles, token, priority);
+    } else {
+        VPainter painter(&mSurface);
+        // set sub surface area for drawing.
+        painter.setDrawRegion(VRect(
+            int(surface.drawRegionPosX()), int(surface.drawRegionPosY()),
+            int(surface.drawRegionWidth()), int(surface.drawRegionHeight())));
+        mSurfaceCache.setCancellationToken(token);
+        mRootLayer->render(&painter, {}, {}, mSurfaceCache);
+        mSurfaceCache.setCancellationToken(nullptr);
+        painter.end();
+    }
+    if (stats) stats->blend = timer.elapsed();
+    return !(token && token->isCancelled());
+}
+
+size_t renderer::Composition::tileCount(const rlottie::Surface &surface) const
+{
+#ifdef LOTTIE_THREAD_SUPPORT
+    // a tile only clears its own pixels, a smaller draw region leaves the
+    // rest of the surface to the untiled path.
+    if (!mTiledRendering || surface.drawRegionPosX() ||
+        surface.drawRegionPosY() ||
+        surface.drawRegionWidth() != surface.width() ||
+        surface.drawRegionHeight() != surface.height())
+        return 1;
+
+    size_t threads = TaskScheduler::instance().concurrency();
+    if (threads < 2) return 1;
+
+    // two bands per thread even out the load of uneven content, every band
+    // walks the whole tree so they don't get thinner than MinTileHeight.
+    const size_t MinTileHeight = 64;
+    return std::min(threads * 2, surface.height() / MinTileHeight);
+#else
+    (void)surface;
+    return 1;
+#endif
+}
+
+void renderer::Composition::renderTiles(size_t                           count,
+                                        const rlottie::CancellationToken *token,
+                                        rlottie::RenderPriority priority)
+{
+#ifdef LOTTIE_THREAD_SUPPORT
+    if (!mTiles) mTiles = std::make_unique<Tiles>();
+    mTiles->priority = priority == rlottie::RenderPriority::Background
+                           ? TaskPriority::BackgroundRaster
+                           : TaskPriority::Raster;
+    auto &tasks = mTiles->tasks;
+    while (tasks.size() < count) {
+        tasks.push_back(std::make_unique<Tiles::Task>());
+    }
+
+    int width = int(mSurface.width());
+    int height = int(mSurface.height());
+    for (size_t i = 0; i < count; i++) {
+        int top = int(height * i / count);
+        int bottom = int(height * (i + 1) / count);
+        auto &task = *tasks[i];
+        task.tiles = mTiles.get();
+        task.composition = this;
+        task.rect = VRect(0, top, width, bottom - top);
+        task.cache.setCancellationToken(token);
+    }
+
+    mTiles->pending = count - 1;
+    for (size_t i = 1; i < count; i++) {
+        TaskScheduler::instance().process(tasks[i].get(), mTiles->priority);
+    }
+    renderTile(tasks[0]->rect, tasks[0]->cache);
+    mTiles->wait();
+
+    for (size_t i = 0; i < count; i++) {
+        tasks[i]->cache.setCancellationToken(nullptr);
+    }
+#else
+    (void)count;
+    (void)token;
+    (void)priority;
+#endif
+}
+
+void renderer::Composition::renderTile(const VRect &tile, SurfaceCache &cache)
+{
+    VPainter painter;
+    painter.begin(&mSurface,
+                  VRect(0, 0, int(mSurface.width()), int(mSurface.height())),
+                  tile);
+    mRootLayer->render(&painter, {}, {}, cache);
     painter.end();
-    return true;
+}
+
+// Surfaces of a layer only cover the clip of the painter they are drawn into,
+// one band of a tiled frame.
+static void beginLayerSurface(VPainter &painter, VBitmap &surface,
+                              const VPainter &target)
+{
+    VRect clip = target.clipBoundingRect();
+    VRect rect = target.drawableRect();
+    painter.begin(&surface,
+                  VRect(-clip.x(), -clip.y(), rect.width(), rect.height()),
+                  clip);
 }
 
 void renderer::Mask::update(int frameNo, const VMatrix &parentMatrix,
@@ -222,7 +390,7 @@ void renderer::Layer::render(VPainter *painter, const VRle &inheritMask,
 
     VRle mask;
     if (mLayerMask) {
-        mask = mLayerMask->maskRle(painter->clipBoundingRect());
+        mask = mLayerMask->maskRle(painter->drawableRect());
         if (!inheritMask.empty()) mask = mask & inheritMask;
         // if resulting mask is empty then return.
         if (mask.empty()) return;
@@ -289,6 +457,7 @@ void renderer::LayerMask::update(int frameNo, const VMatrix &parentMatrix,
 
 VRle renderer::LayerMask::maskRle(const VRect &clipRect)
 {
+    std::lock_guard<std::mutex> lock(mMutex);
     if (!mDirty) return mRle;
 
     VRle rle;
@@ -333,6 +502,8 @@ VRle renderer::LayerMask::maskRle(const VRect &clipRect)
     } else {
         mRle = rle;
     }
+    // the bounding rect is computed on first use, not while tiles share it.
+    mRle.boundingRect();
     mDirty = false;
     return mRle;
 }
@@ -500,13 +671,13 @@ void renderer::CompLayer::render(VPainter *painter, const VRle &inheritMask,
         renderHelper(painter, inheritMask, matteRle, cache);
     } else {
         if (complexContent()) {
-            VSize    size = painter->clipBoundingRect().size();
+            VRect    clip = painter->clipBoundingRect();
             VPainter srcPainter;
-            VBitmap srcBitmap = cache.make_surface(size.width(), size.height());
-            srcPainter.begin(&srcBitmap);
+            VBitmap srcBitmap = cache.make_surface(clip.width(), clip.height());
+            beginLayerSurface(srcPainter, srcBitmap, *painter);
             renderHelper(&srcPainter, inheritMask, matteRle, cache);
             srcPainter.end();
-            painter->drawBitmap(VPoint(), srcBitmap,
+            painter->drawBitmap(VPoint(clip.x(), clip.y()), srcBitmap,
                                 uchar(combinedAlpha() * 255.0f));
             cache.release_surface(srcBitmap);
         } else {
@@ -522,7 +693,7 @@ void renderer::CompLayer::renderHelper(VPainter *    painter,
 {
     VRle mask;
     if (mLayerMask) {
-        mask = mLayerMask->maskRle(painter->clipBoundingRect());
+        mask = mLayerMask->maskRle(painter->drawableRect());
         if (!inheritMask.empty()) mask = mask & inheritMask;
         // if resulting mask is empty then return.
         if (mask.empty()) return;
@@ -537,6 +708,7 @@ void renderer::CompLayer::renderHelper(VPainter *    painter,
 
     renderer::Layer *matte = nullptr;
     for (const auto &layer : mLayers) {
+        if (cache.cancelled()) return;
         if (layer->hasMatte()) {
             matte = layer;
         } else {
@@ -560,19 +732,19 @@ void renderer::CompLayer::renderMatteLayer(VPainter *painter, const VRle &mask,
                                            renderer::Layer *src,
                                            SurfaceCache &   cache)
 {
-    VSize size = painter->clipBoundingRect().size();
+    VRect clip = painter->clipBoundingRect();
     // Decide if we can use fast matte.
     // 1. draw src layer to matte buffer
     VPainter srcPainter;
-    VBitmap  srcBitmap = cache.make_surface(size.width(), size.height());
-    srcPainter.begin(&srcBitmap);
+    VBitmap  srcBitmap = cache.make_surface(clip.width(), clip.height());
+    beginLayerSurface(srcPainter, srcBitmap, *painter);
     src->render(&srcPainter, mask, matteRle, cache);
     srcPainter.end();
 
     // 2. draw layer to layer buffer
     VPainter layerPainter;
-    VBitmap  layerBitmap = cache.make_surface(size.width(), size.height());
-    layerPainter.begin(&layerBitmap);
+    VBitmap  layerBitmap = cache.make_surface(clip.width(), clip.height());
+    beginLayerSurface(layerPainter, layerBitmap, *painter);
     layer->render(&layerPainter, mask, matteRle, cache);
 
     // 2.1update composition mode
@@ -598,10 +770,10 @@ void renderer::CompLayer::renderMatteLayer(VPainter *painter, const VRle &mask,
     }
 
     // 2.3 draw src buffer as mask
-    layerPainter.drawBitmap(VPoint(), srcBitmap);
+    layerPainter.drawBitmap(VPoint(clip.x(), clip.y()), srcBitmap);
     layerPainter.end();
     // 3. draw the result buffer into painter
-    painter->drawBitmap(VPoint(), layerBitmap);
+    painter->drawBitmap(VPoint(clip.x(), clip.y()), layerBitmap);
 
     cache.release_surface(srcBitmap);
     cache.release_surface(layerBitmap);
@@ -626,9 +798,7 @@ VRle renderer::Clipper::rle(const VRle &mask)
 {
     if (mask.empty()) return mRasterizer.rle();
 
-    mMaskedRle.clone(mask);
-    mMaskedRle &= mRasterizer.rle();
-    return mMaskedRle;
+    return mask & mRasterizer.rle();
 }
 
 void renderer::CompLayer::updateContent()
@@ -833,10 +1003,15 @@ void renderer::ShapeLayer::updateContent()
     }
 }
 
-void renderer::ShapeLayer::preprocessStage(const VRect &clip)
+void renderer::ShapeLayer::collectDrawables()
 {
     mDrawableList.clear();
     mRoot->renderList(mDrawableList);
+}
+
+void renderer::ShapeLayer::preprocessStage(const VRect &clip)
+{
+    collectDrawables();
 
     for (auto &drawable : mDrawableList) drawable->preprocess(clip);
 }
@@ -845,9 +1020,8 @@ renderer::DrawableList renderer::ShapeLayer::renderList()
 {
     if (skipRendering()) return {};
 
-    mDrawableList.clear();
-    mRoot->renderList(mDrawableList);
-
+    // collected by preprocessStage() of this frame, the tiles of a frame
+    // read it at the same time.
     if (mDrawableList.empty()) return {};
 
     return {mDrawableList.data(), mDrawableList.size()};
@@ -24,6 +24,7 @@
 #define LOTTIEITEM_H
 
 #include <memory>
+#include <mutex>
 #include <sstream>
 
 #include "lottiekeypath.h"
@@ -107,8 +108,17 @@ public:
 
     void release_surface(VBitmap &surface) { mCache.push_back(surface); }
 
+    // the cache travels with every layer render of a frame, so it also
+    // carries the token that cancels the frame between layers.
+    void setCancellationToken(const rlottie::CancellationToken *token)
+    {
+        mToken = token;
+    }
+    bool cancelled() const { return mToken && mToken->isCancelled(); }
+
 private:
-    std::vector<VBitmap> mCache;
+    std::vector<VBitmap>              mCache;
+    const rlottie::CancellationToken *mToken{nullptr};
 };
 
 class Drawable final : public VDrawable {
@@ -143,7 +153,6 @@ public:
 public:
     VSize       mSize;
     VPath       mPath;
-    VRle        mMaskedRle;
     VRasterizer mRasterizer;
     bool        mRasterRequest{false};
 };
@@ -183,6 +192,8 @@ public:
     VRle              mRle;
     bool              mStatic{true};
     bool              mDirty{true};
+    // the tiles of a frame ask for the mask at the same time.
+    std::mutex        mMutex;
 };
 
 class Layer;
@@ -190,15 +201,30 @@ class Layer;
 class Composition {
 public:
     explicit Composition(std::shared_ptr<model::Composition> composition);
+    ~Composition();
     bool  update(int frameNo, const VSize &size, bool keepAspectRatio);
     VSize size() const { return mViewSize; }
     void  buildRenderTree();
     const LOTLayerNode *renderTree() const;
-    bool                render(const rlottie::Surface &surface);
+    bool                render(const rlottie::Surface &surface,
+                               rlottie::FrameStats *     stats = nullptr,
+                               const rlottie::CancellationToken *token = nullptr,
+                               rlottie::RenderPriority priority =
+                                   rlottie::RenderPriority::Frame);
     void                setValue(const std::string &keypath, LOTVariant &value);
+    const std::shared_ptr<model::Composition> &model() const { return mModel; }
+    void setTiledRendering(bool enable) { mTiledRendering = enable; }
 
 private:
+    struct Tiles;
+
+    size_t tileCount(const rlottie::Surface &surface) const;
+    void   renderTiles(size_t count, const rlottie::CancellationToken *token,
+                       rlottie::RenderPriority priority);
+    void   renderTile(const VRect &tile, SurfaceCache &cache);
+
     SurfaceCache                        mSurfaceCache;
+    std::unique_ptr<Tiles>              mTiles;
     VBitmap                             mSurface;
     VMatrix                             mScaleMatrix;
     VSize                               mViewSize;
@@ -207,6 +233,7 @@ private:
     VArenaAlloc                         mAllocator{2048};
     int                                 mCurFrameNo;
     bool                                mKeepAspectRatio{true};
+    bool                                mTiledRendering{false};
 };
 
 class Layer {
@@ -323,6 +350,7 @@ public:
 protected:
     void                     preprocessStage(const VRect &clip) final;
     void                     updateContent() final;
+    void                     collectDrawables();
     std::vector<VDrawable *> mDrawableList;
     Group *                  mRoot{nullptr};
 };
@@ -70,6 +70,8 @@ void renderer::ShapeLayer::buildLayerNode()
 {
     renderer::Layer::buildLayerNode();
 
+    // the tree is built without preprocessing the frame.
+    collectDrawables();
     auto renderlist = renderList();
 
     cnodes().clear();
@@ -26,6 +26,14 @@
 
 #include "lottiemodel.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LOTTIE_MMAP_SUPPORT
+#endif
+
 using namespace rlottie::internal;
 
 #ifdef LOTTIE_CACHE_SUPPORT
@@ -108,6 +116,60 @@ static std::string dirname(const std::string &path)
     return std::string(path, 0, len);
 }
 
+/*
+ * Null terminated, writable view of a file for the in place parser. Where
+ * possible the file is mapped copy on write over a zeroed anonymous mapping
+ * one byte longer than the file, so the byte after the content is always a
+ * terminator and nothing is copied. Otherwise the file is read into memory.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path)
+    {
+#ifdef LOTTIE_MMAP_SUPPORT
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            mMappedSize = size_t(info.st_size) + 1;
+            void *area = mmap(nullptr, mMappedSize, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (area != MAP_FAILED &&
+                mmap(area, size_t(info.st_size), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                mData = static_cast<char *>(area);
+            } else if (area != MAP_FAILED) {
+                munmap(area, mMappedSize);
+            }
+        }
+        close(fd);
+        if (mData) return;
+        mMappedSize = 0;
+#endif
+        std::ifstream f(path, std::ios::binary);
+        if (!f.is_open()) return;
+        std::stringstream content;
+        content << f.rdbuf();
+        mContent = content.str();
+        mData = const_cast<char *>(mContent.c_str());
+    }
+    ~MappedFile()
+    {
+#ifdef LOTTIE_MMAP_SUPPORT
+        if (mMappedSize) munmap(mData, mMappedSize);
+#endif
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    char *data() const { return mData; }
+
+private:
+    char *      mData{nullptr};
+    size_t      mMappedSize{0};
+    std::string mContent;
+};
+
 void model::configureModelCacheSize(size_t cacheSize)
 {
     ModelCache::instance().configureCacheSize(cacheSize);
@@ -121,27 +183,35 @@ std::shared_ptr<model::Composition> model::loadFromFile(const std::string &path,
         if (obj) return obj;
     }
 
-    std::ifstream f;
-    f.open(path);
+    MappedFile file(path);
 
-    if (!f.is_open()) {
+    if (!file.data()) {
         vCritical << "failed to open file = " << path.c_str();
         return {};
-    } else {
-        std::string content;
-
-        std::getline(f, content, '\0');
-        f.close();
+    }
+    if (!*file.data()) return {};
 
-        if (content.empty()) return {};
+    auto obj = internal::model::parse(file.data(), dirname(path));
 
-        auto obj = internal::model::parse(const_cast<char *>(content.c_str()),
-                                          dirname(path));
+    if (obj && cachePolicy) ModelCache::instance().add(path, obj);
 
-        if (obj && cachePolicy) ModelCache::instance().add(path, obj);
+    return obj;
+}
 
-        return obj;
+std::shared_ptr<model::Composition> model::loadFromBuffer(
+    char *data, const std::string &key, std::string resourcePath,
+    bool cachePolicy)
+{
+    if (cachePolicy) {
+        auto obj = ModelCache::instance().find(key);
+        if (obj) return obj;
     }
+
+    auto obj = internal::model::parse(data, std::move(resourcePath));
+
+    if (obj && cachePolicy) ModelCache::instance().add(key, obj);
+
+    return obj;
 }
 
 std::shared_ptr<model::Composition> model::loadFromData(
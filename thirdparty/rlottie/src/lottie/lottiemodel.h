@@ -1136,6 +1136,11 @@ std::shared_ptr<model::Composition> loadFromData(std::string jsonData,
                                                  std::string resourcePath,
                                                  ColorFilter filter);
 
+std::shared_ptr<model::Composition> loadFromBuffer(char              *data,
+                                                   const std::string &key,
+                                                   std::string resourcePath,
+                                                   bool        cachePolicy);
+
 std::shared_ptr<model::Composition> parse(char *str, std::string dir_path,
                                           ColorFilter filter = {});
 
@@ -183,6 +183,13 @@ void VRasterBuffer::clear()
     memset(mBuffer, 0, mHeight * mBytesPerLine);
 }
 
+void VRasterBuffer::clear(const VRect &rect)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y) {
+        memset(pixelRef(rect.left(), y), 0, rect.width() * mBytesPerPixel);
+    }
+}
+
 VBitmap::Format VRasterBuffer::prepare(const VBitmap *image)
 {
     mBuffer = image->data();
@@ -124,6 +124,7 @@ class VRasterBuffer {
 public:
     VBitmap::Format prepare(const VBitmap *image);
     void            clear();
+    void            clear(const VRect &rect);
 
     void resetBuffer(int val = 0);
 
@@ -197,7 +198,9 @@ struct VSpanData {
                int alpha = 255);
     void setupMatrix(const VMatrix &matrix);
 
-    VRect clipRect() const
+    VRect clipRect() const { return mClip; }
+
+    VRect drawableRect() const
     {
         return VRect(0, 0, mDrawableSize.width(), mDrawableSize.height());
     }
@@ -206,8 +209,11 @@ struct VSpanData {
     {
         mOffset = VPoint(region.left(), region.top());
         mDrawableSize = VSize(region.width(), region.height());
+        mClip = drawableRect();
     }
 
+    void setClip(const VRect &clip) { mClip = clip & drawableRect(); }
+
     uint *buffer(int x, int y) const
     {
         return mRasterBuffer->pixelRef(x + mOffset.x(), y + mOffset.y());
@@ -223,6 +229,7 @@ struct VSpanData {
     std::shared_ptr<const VColorTable> mColorTable{nullptr};
     VPoint                             mOffset;  // offset to the subsurface
     VSize                              mDrawableSize;  // suburface size
+    VRect                              mClip;  // part of the subsurface drawn
     uint32_t                           mSolid;
     VGradientData                      mGradient;
     VTextureData                       mTexture;
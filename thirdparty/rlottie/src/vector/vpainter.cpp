@@ -45,15 +45,23 @@ void VPainter::drawRle(const VRle &rle, const VRle &clip)
 
     if (!mSpanData.mUnclippedBlendFunc) return;
 
+    if (mSpanData.clipRect() != mSpanData.drawableRect()) {
+        // painting a tile, the clip reaches past it.
+        rle.intersect(mSpanData.clipRect() & clip,
+                      mSpanData.mUnclippedBlendFunc, &mSpanData);
+        return;
+    }
+
     rle.intersect(clip, mSpanData.mUnclippedBlendFunc, &mSpanData);
 }
 
 static void fillRect(const VRect &r, VSpanData *data)
 {
-    auto x1 = std::max(r.x(), 0);
-    auto x2 = std::min(r.x() + r.width(), data->mDrawableSize.width());
-    auto y1 = std::max(r.y(), 0);
-    auto y2 = std::min(r.y() + r.height(), data->mDrawableSize.height());
+    const VRect clip = data->clipRect();
+    auto x1 = std::max(r.x(), clip.left());
+    auto x2 = std::min(r.x() + r.width(), clip.right());
+    auto y1 = std::max(r.y(), clip.top());
+    auto y2 = std::min(r.y() + r.height(), clip.bottom());
 
     if (x2 <= x1 || y2 <= y1) return;
 
@@ -104,6 +112,19 @@ bool VPainter::begin(VBitmap *buffer)
     mBuffer.clear();
     return true;
 }
+
+bool VPainter::begin(VBitmap *buffer, const VRect &drawRegion,
+                     const VRect &clip)
+{
+    mBuffer.prepare(buffer);
+    mSpanData.init(&mBuffer);
+    mSpanData.setDrawRegion(drawRegion);
+    mSpanData.setClip(clip);
+    mBuffer.clear(mSpanData.clipRect().translated(drawRegion.left(),
+                                                  drawRegion.top()));
+    return true;
+}
+
 void VPainter::end() {}
 
 void VPainter::setDrawRegion(const VRect &region)
@@ -126,6 +147,11 @@ VRect VPainter::clipBoundingRect() const
     return mSpanData.clipRect();
 }
 
+VRect VPainter::drawableRect() const
+{
+    return mSpanData.drawableRect();
+}
+
 void VPainter::drawBitmap(const VPoint &point, const VBitmap &bitmap,
                           const VRect &source, uint8_t const_alpha)
 {
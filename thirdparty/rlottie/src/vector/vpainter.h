@@ -36,6 +36,9 @@ public:
     VPainter() = default;
     explicit VPainter(VBitmap *buffer);
     bool  begin(VBitmap *buffer);
+    // Paints and clears only the clip of the draw region, painters on
+    // disjoint tiles of one buffer can run at the same time.
+    bool  begin(VBitmap *buffer, const VRect &drawRegion, const VRect &clip);
     void  end();
     void  setDrawRegion(const VRect &region); // sub surface rendering area.
     void  setBrush(const VBrush &brush);
@@ -43,6 +46,7 @@ public:
     void  drawRle(const VPoint &pos, const VRle &rle);
     void  drawRle(const VRle &rle, const VRle &clip);
     VRect clipBoundingRect() const;
+    VRect drawableRect() const;
 
     void  drawBitmap(const VPoint &point, const VBitmap &bitmap, const VRect &source, uint8_t const_alpha = 255);
     void  drawBitmap(const VRect &target, const VBitmap &bitmap, const VRect &source, uint8_t const_alpha = 255);
@@ -30,6 +30,7 @@
 #include "vmatrix.h"
 #include "vpath.h"
 #include "vrle.h"
+#include "vtaskscheduler.h"
 
 V_BEGIN_NAMESPACE
 
@@ -272,16 +273,26 @@ public:
     VRle &unsafe() { return _rle; }
     void  notify()
     {
-        {
-            std::lock_guard<std::mutex> lock(_mutex);
-            _ready = true;
-        }
-        _cv.notify_one();
+        // notified under the lock, a waiter that sees _ready may destroy the
+        // task as soon as it got the mutex. Every band of a tiled frame may
+        // be waiting.
+        std::lock_guard<std::mutex> lock(_mutex);
+        _ready = true;
+        _cv.notify_all();
     }
     void wait()
     {
         if (!_pending) return;
 
+#ifdef LOTTIE_THREAD_SUPPORT
+        // The pool is shared with the render tasks, a render waiting here
+        // may hold the very worker its rasterization needs. Queued
+        // rasterization runs on this thread until the result is in.
+        while (!_ready.load(std::memory_order_acquire) &&
+               TaskScheduler::instance().runPending(TaskPriority::Raster))
+            ;
+#endif
+
         {
             std::unique_lock<std::mutex> lock(_mutex);
             while (!_ready) _cv.wait(lock);
@@ -307,11 +318,12 @@ private:
     VRle                    _rle;
     std::mutex              _mutex;
     std::condition_variable _cv;
-    bool                    _ready{true};
-    bool                    _pending{false};
+    std::atomic<bool>       _ready{true};
+    // the tiles of a frame wait on the same rle.
+    std::atomic<bool>       _pending{false};
 };
 
-struct VRleTask {
+struct VRleTask : public SchedulerTask {
     SharedRle mRle;
     VPath     mPath;
     float     mStrokeWidth;
@@ -369,6 +381,8 @@ struct VRleTask {
         sw_ft_grays_raster.raster_render(nullptr, &params);
     }
 
+    void run() override;
+
     void operator()(FTOutline &outRef, SW_FT_Stroker &stroker)
     {
         if (mPath.points().size() > SHRT_MAX ||
@@ -413,56 +427,30 @@ struct VRleTask {
     }
 };
 
-using VTask = std::shared_ptr<VRleTask>;
-
 #ifdef LOTTIE_THREAD_SUPPORT
 
-#include <thread>
-#include "vtaskqueue.h"
-
-class RleTaskScheduler {
-    const unsigned                _count{std::thread::hardware_concurrency()};
-    std::vector<std::thread>      _threads;
-    std::vector<TaskQueue<VTask>> _q{_count};
-    std::atomic<unsigned>         _index{0};
-
-    void run(unsigned i)
-    {
-        /*
-         * initalize  per thread objects.
-         */
-        FTOutline     outlineRef;
-        SW_FT_Stroker stroker;
-        SW_FT_Stroker_New(&stroker);
-
-        // Task Loop
-        VTask task;
-        while (true) {
-            bool success = false;
-
-            for (unsigned n = 0; n != _count * 2; ++n) {
-                if (_q[(i + n) % _count].try_pop(task)) {
-                    success = true;
-                    break;
-                }
-            }
-
-            if (!success && !_q[i].pop(task)) break;
-
-            (*task)(outlineRef, stroker);
-        }
+/*
+ * Scratch state of a rasterizing thread, reused by every task it runs.
+ */
+struct RleTaskContext {
+    FTOutline     outlineRef;
+    SW_FT_Stroker stroker;
 
-        // cleanup
-        SW_FT_Stroker_Done(stroker);
-    }
+    RleTaskContext() { SW_FT_Stroker_New(&stroker); }
+    ~RleTaskContext() { SW_FT_Stroker_Done(stroker); }
+};
 
-    RleTaskScheduler()
-    {
-        for (unsigned n = 0; n != _count; ++n) {
-            _threads.emplace_back([&, n] { run(n); });
-        }
-    }
+void VRleTask::run()
+{
+    static thread_local RleTaskContext context;
+    (*this)(context.outlineRef, context.stroker);
+}
 
+/*
+ * The task of a rasterizer lives inside it and is handed to the shared pool
+ * by pointer, submitting a path allocates nothing.
+ */
+class RleTaskScheduler {
 public:
     static RleTaskScheduler &instance()
     {
@@ -470,24 +458,9 @@ public:
         return singleton;
     }
 
-    ~RleTaskScheduler()
-    {
-        for (auto &e : _q) e.done();
-
-        for (auto &e : _threads) e.join();
-    }
-
-    void process(VTask task)
+    void process(VRleTask *task)
     {
-        auto i = _index++;
-
-        for (unsigned n = 0; n != _count; ++n) {
-            if (_q[(i + n) % _count].try_push(std::move(task))) return;
-        }
-
-        if (_count > 0) {
-            _q[i % _count].push(std::move(task));
-        }
+        TaskScheduler::instance().process(task, TaskPriority::Raster);
     }
 };
 
@@ -509,13 +482,22 @@ public:
 
     ~RleTaskScheduler() { SW_FT_Stroker_Done(stroker); }
 
-    void process(VTask task) { (*task)(outlineRef, stroker); }
+    void process(VRleTask *task) { (*task)(outlineRef, stroker); }
 };
+
+void VRleTask::run()
+{
+    RleTaskScheduler::instance().process(this);
+}
 #endif
 
 struct VRasterizer::VRasterizerImpl {
     VRleTask mTask;
 
+    // the scheduler only holds a pointer to the task, it has to finish
+    // before the task goes away.
+    ~VRasterizerImpl() { mTask.mRle.wait(); }
+
     VRle &    rle() { return mTask.rle(); }
     VRleTask &task() { return mTask; }
 };
@@ -533,8 +515,7 @@ void VRasterizer::init()
 
 void VRasterizer::updateRequest()
 {
-    VTask taskObj = VTask(d, &d->task());
-    RleTaskScheduler::instance().process(std::move(taskObj));
+    RleTaskScheduler::instance().process(&d->task());
 }
 
 void VRasterizer::rasterize(VPath path, FillRule fillRule, const VRect &clip)
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "vtaskscheduler.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+static void setThreadAffinity(uint64_t mask)
+{
+#if defined(__linux__)
+    if (!mask) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < 64; ++cpu) {
+        if (mask & (uint64_t(1) << cpu)) CPU_SET(cpu, &set);
+    }
+    sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)mask;
+#endif
+}
+
+TaskScheduler::Registry::~Registry()
+{
+    for (Producer *p = head.load(); p;) {
+        Producer *next = p->next;
+        delete p;
+        p = next;
+    }
+}
+
+TaskScheduler::ProducerHandle::~ProducerHandle()
+{
+    // the deques go to the next thread that submits, tasks left in them are
+    // still stolen.
+    if (producer) producer->owned.store(false, std::memory_order_release);
+}
+
+TaskScheduler &TaskScheduler::instance()
+{
+    static TaskScheduler singleton;
+    return singleton;
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    stop();
+}
+
+TaskScheduler::Producer *TaskScheduler::producer()
+{
+    static thread_local ProducerHandle handle;
+    if (handle.producer) return handle.producer;
+
+    handle.registry = _registry;
+    Producer *head = _registry->head.load(std::memory_order_acquire);
+    for (Producer *p = head; p; p = p->next) {
+        bool owned = false;
+        if (p->owned.compare_exchange_strong(owned, true,
+                                             std::memory_order_acquire)) {
+            handle.producer = p;
+            return p;
+        }
+    }
+    Producer *p = new Producer;
+    p->next = head;
+    while (!_registry->head.compare_exchange_weak(p->next, p,
+                                                  std::memory_order_acq_rel))
+        ;
+    handle.producer = p;
+    return p;
+}
+
+SchedulerTask *TaskScheduler::steal(unsigned i, TaskPriority last)
+{
+    // every worker starts with a different victim.
+    Producer *head = _registry->head.load(std::memory_order_acquire);
+    Producer *start = head;
+    for (unsigned n = 0; n != i && start; ++n) start = start->next;
+    if (!start) start = head;
+
+    for (size_t priority = 0; priority <= size_t(last); ++priority) {
+        for (Producer *p = start; p; p = p->next) {
+            if (SchedulerTask *task = p->deques[priority].steal()) return task;
+        }
+        for (Producer *p = head; p != start; p = p->next) {
+            if (SchedulerTask *task = p->deques[priority].steal()) return task;
+        }
+    }
+    return nullptr;
+}
+
+bool TaskScheduler::pending() const
+{
+    for (Producer *p = _registry->head.load(std::memory_order_acquire); p;
+         p = p->next) {
+        for (auto &deque : p->deques) {
+            if (!deque.empty()) return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::run(unsigned i)
+{
+    setThreadAffinity(_affinityMask);
+
+    while (!_stop) {
+        SchedulerTask *task = nullptr;
+        for (unsigned spin = 0; !task && spin != 32; ++spin) {
+            task = steal(i, TaskPriority::Background);
+            if (!task) std::this_thread::yield();
+        }
+        if (task) {
+            task->run();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        uint64_t                     epoch = _epoch;
+        _sleeping.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // a submission either sees this worker asleep or is seen here.
+        if (!pending()) {
+            while (epoch == _epoch && !_stop) _wakeup.wait(lock);
+        }
+        _sleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void TaskScheduler::drain()
+{
+    while (SchedulerTask *task = steal(0, TaskPriority::Background)) {
+        task->run();
+    }
+}
+
+void TaskScheduler::start()
+{
+    for (unsigned n = 0; n != _concurrency; ++n) {
+        _threads.emplace_back([this, n] { run(n); });
+    }
+    _started = true;
+}
+
+void TaskScheduler::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        ++_epoch;
+    }
+    _wakeup.notify_all();
+
+    for (auto &e : _threads) e.join();
+    _threads.clear();
+    _stop = false;
+}
+
+void TaskScheduler::configure(size_t threads, uint64_t affinityMask)
+{
+    std::lock_guard<std::mutex> lock(_configMutex);
+    stop();
+    std::atomic_store(&_executor, std::shared_ptr<const Executor>());
+    _affinityMask = affinityMask;
+    _concurrency =
+        threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    // only the size is recorded until the first submission, unless the pool
+    // was already running and tasks may be queued for it.
+    if (_started) start();
+}
+
+void TaskScheduler::configure(Executor executor)
+{
+    if (!executor) return;
+
+    std::lock_guard<std::mutex> lock(_configMutex);
+    stop();
+    std::atomic_store(&_executor, std::make_shared<const Executor>(
+                                      std::move(executor)));
+    _concurrency = std::max(1u, std::thread::hardware_concurrency());
+    _started = true;
+    // tasks queued for the threads that just stopped.
+    if (pending()) (*_executor)([this] { drain(); });
+}
+
+void TaskScheduler::process(SchedulerTask *task, TaskPriority priority)
+{
+    // the workers start with the first task, a process that never renders
+    // never starts them.
+    if (!_started) {
+        std::lock_guard<std::mutex> lock(_configMutex);
+        if (!_started) start();
+    }
+
+    producer()->deques[size_t(priority)].push(task);
+
+    if (auto executor = std::atomic_load(&_executor)) {
+        (*executor)([this] { drain(); });
+        return;
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_sleeping.load(std::memory_order_relaxed) == 0) return;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_epoch;
+    }
+    _wakeup.notify_one();
+}
+
+bool TaskScheduler::runPending(TaskPriority priority)
+{
+    // only tasks of exactly this priority, a waiting thread must not pick
+    // up a heavier task.
+    SchedulerTask *task = producer()->deques[size_t(priority)].take();
+    if (!task) {
+        Producer *head = _registry->head.load(std::memory_order_acquire);
+        for (Producer *p = head; p && !task; p = p->next) {
+            task = p->deques[size_t(priority)].steal();
+        }
+    }
+    if (!task) return false;
+
+    task->run();
+    return true;
+}
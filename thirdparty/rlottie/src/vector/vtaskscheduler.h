@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VTASKSCHEDULER_H
+#define VTASKSCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Chase-Lev work stealing deque of task pointers, following "Correct and
+ * Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013).
+ * Only the owning thread pushes and takes at the bottom, any thread steals
+ * from the top without a lock. The ring doubles when it is full, replaced
+ * rings stay alive with the deque as a thief may still be reading them.
+ */
+template <typename T>
+class StealingDeque {
+    class Ring {
+        int64_t                             _mask;
+        std::unique_ptr<std::atomic<T *>[]> _items;
+
+    public:
+        explicit Ring(int64_t capacity)
+            : _mask(capacity - 1), _items(new std::atomic<T *>[capacity])
+        {
+        }
+        int64_t capacity() const { return _mask + 1; }
+        T *     get(int64_t i) const
+        {
+            return _items[i & _mask].load(std::memory_order_relaxed);
+        }
+        void put(int64_t i, T *item)
+        {
+            _items[i & _mask].store(item, std::memory_order_relaxed);
+        }
+        Ring *grow(int64_t bottom, int64_t top) const
+        {
+            Ring *ring = new Ring(capacity() * 2);
+            for (int64_t i = top; i != bottom; ++i) ring->put(i, get(i));
+            return ring;
+        }
+    };
+
+    // Thieves write _top and the owner _bottom, each sits on a cache line of
+    // its own. Padded instead of aligned, the deques are allocated with a
+    // plain new that doesn't honor extended alignment before C++17.
+    enum { CacheLine = 64 };
+    char                               _pad0[CacheLine];
+    std::atomic<int64_t>               _top{0};
+    char                               _pad1[CacheLine - sizeof(_top)];
+    std::atomic<int64_t>               _bottom{0};
+    char                               _pad2[CacheLine - sizeof(_bottom)];
+    std::atomic<Ring *>                _ring;
+    std::vector<std::unique_ptr<Ring>> _rings;
+
+public:
+    explicit StealingDeque(int64_t capacity = 64)
+    {
+        _rings.emplace_back(new Ring(capacity));
+        _ring.store(_rings.back().get(), std::memory_order_relaxed);
+    }
+
+    bool empty() const
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t t = _top.load(std::memory_order_relaxed);
+        return b <= t;
+    }
+
+    // owner only
+    void push(T *item)
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t t = _top.load(std::memory_order_acquire);
+        Ring *  ring = _ring.load(std::memory_order_relaxed);
+        if (b - t > ring->capacity() - 1) {
+            _rings.emplace_back(ring->grow(b, t));
+            ring = _rings.back().get();
+            _ring.store(ring, std::memory_order_release);
+        }
+        ring->put(b, item);
+        _bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // owner only
+    T *take()
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        Ring *  ring = _ring.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = _top.load(std::memory_order_relaxed);
+        if (t > b) {
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T *item = ring->get(b);
+        if (t == b) {
+            // last item, race the thieves for it.
+            if (!_top.compare_exchange_strong(t, t + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed))
+                item = nullptr;
+            _bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // any thread, returns nullptr when empty or when another thief won.
+    T *steal()
+    {
+        int64_t t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = _bottom.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        T *item = _ring.load(std::memory_order_acquire)->get(t);
+        if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed))
+            return nullptr;
+        return item;
+    }
+};
+
+class SchedulerTask {
+public:
+    virtual ~SchedulerTask() = default;
+    virtual void run() = 0;
+};
+
+/*
+ * Workers always pick the most urgent task. Raster tasks come first, a frame
+ * in progress waits on them. The bands of a background render come after
+ * every frame render but before the next background render starts, and
+ * background renders only run when nothing else is queued.
+ */
+enum class TaskPriority { Raster, Frame, BackgroundRaster, Background, Count };
+
+/*
+ * One pool of worker threads runs the render and the rasterization tasks of
+ * every Animation. Every thread that submits work owns a StealingDeque per
+ * priority, so submitting never takes a lock, and the workers steal from all
+ * of them. Idle workers spin briefly before they sleep and a submission only
+ * touches the mutex when some worker is asleep.
+ *
+ * Instead of its own threads the pool can run on a host provided executor,
+ * every submission then posts a job that runs queued tasks until none is
+ * left.
+ *
+ * Tasks are not owned by the scheduler, the submitter keeps a task alive
+ * until it ran.
+ */
+class TaskScheduler {
+public:
+    using Executor = std::function<void(std::function<void()>)>;
+
+    static TaskScheduler &instance();
+
+    // 0 threads picks one per core, a zero mask leaves the affinity alone.
+    // The threads start with the first submitted task.
+    void configure(size_t threads, uint64_t affinityMask);
+    void configure(Executor executor);
+
+    void process(SchedulerTask *task, TaskPriority priority);
+
+    // number of tasks that can run at the same time.
+    size_t concurrency() const { return _concurrency; }
+
+    // Runs one queued task of the given priority on the calling thread, its
+    // own tasks first. Lets a thread waiting on tasks help instead of
+    // holding on to a worker the tasks need.
+    bool runPending(TaskPriority priority);
+
+    ~TaskScheduler();
+
+private:
+    struct Producer {
+        StealingDeque<SchedulerTask> deques[size_t(TaskPriority::Count)];
+        std::atomic<bool>            owned{true};
+        Producer *                   next{nullptr};
+    };
+
+    // Submitting threads can outlive the scheduler at exit, each of them
+    // keeps the deques alive until it let go of its own.
+    struct Registry {
+        std::atomic<Producer *> head{nullptr};
+        ~Registry();
+    };
+
+    struct ProducerHandle {
+        std::shared_ptr<Registry> registry;
+        Producer *                producer{nullptr};
+        ~ProducerHandle();
+    };
+
+    TaskScheduler() = default;
+
+    Producer *     producer();
+    SchedulerTask *steal(unsigned i, TaskPriority last);
+    bool           pending() const;
+    void           run(unsigned i);
+    void           drain();
+    void           start();
+    void           stop();
+
+    std::vector<std::thread>       _threads;
+    std::shared_ptr<Registry>      _registry{std::make_shared<Registry>()};
+    std::shared_ptr<const Executor> _executor;
+    uint64_t                       _affinityMask{0};
+    std::atomic<size_t>            _concurrency{
+        std::max(1u, std::thread::hardware_concurrency())};
+    // set once the threads run or an executor took their place.
+    std::atomic<bool>              _started{false};
+    std::mutex                     _configMutex;
+    std::atomic<unsigned>          _sleeping{0};
+    std::atomic<bool>              _stop{false};
+    std::mutex                     _mutex;
+    std::condition_variable        _wakeup;
+    uint64_t                       _epoch{0};
+};
+
+#endif  // VTASKSCHEDULER_H
@@ -0,0 +1,33 @@
+extends SceneTree
+
+# Converts every Lottie JSON below a directory into scenes without opening the
+# editor, for example:
+# godot --no-window -s tools/lottie_batch.gd -- <source dir> <target dir> --threads=8 --scale="Vector2(2, 2)"
+# Every other --name=value argument sets the import option of that name, the
+# value is parsed with str2var.
+
+
+func _init():
+	var paths = []
+	var options = {}
+	var threads = 0
+	var user_args = false
+	for arg in OS.get_cmdline_args():
+		# Engine arguments come before the script path or "--".
+		if arg == "--" or arg.ends_with(".gd"):
+			user_args = true
+		elif not user_args:
+			continue
+		elif arg.begins_with("--threads="):
+			threads = int(arg.get_slice("=", 1))
+		elif arg.begins_with("--") and arg.find("=") != -1:
+			var name = arg.substr(2, arg.find("=") - 2)
+			options[name] = str2var(arg.substr(arg.find("=") + 1, arg.length()))
+		else:
+			paths.append(arg)
+	if paths.size() != 2:
+		printerr("Usage: godot --no-window -s lottie_batch.gd -- <source dir> <target dir> [--threads=N] [--<import option>=<value>]")
+		quit(1)
+		return
+	var result = LottieBatchConverter.new().convert_directory(paths[0], paths[1], options, threads)
+	quit(0 if result["failed"] == 0 else 1)